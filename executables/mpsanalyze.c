@@ -0,0 +1,328 @@
+/*
+ * MPSanalyze.c
+ * Computes statistics over a set of MPSShow data files (.MPS), the run length and
+ * colour index distributions, the compression ratio of every slide, and the palette
+ * entries actually used. The statistics are taken directly from the RLE data, the
+ * images are only decoded if asked, to check that they decode to a full image.
+ *
+ * The files are processed in parallel, each thread keeps its own histograms which
+ * are merged once all the files are done. Output is JSON or CSV.
+ *
+ * To obtain the .MPS file you can use 'MPSextract' on a MPSShow slideshow demo exe file
+ *
+ * This code is offered without warranty under the MIT License. Use it as you will
+ * personally or commercially, just give credit if you do.
+ */
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "util.h"
+#include "mps-show.h"
+#include "parallel.h"
+
+#define IMAGE_WIDTH (320)
+#define IMAGE_HEIGHT (200)
+#define IMAGE_SIZE (IMAGE_WIDTH * IMAGE_HEIGHT)
+#define NSUB (4)    // number of interleaved sub-histograms used while counting a slide
+
+// statistics for a single slide
+typedef struct {
+    uint32_t    runs;           // number of RLE records
+    uint32_t    pixels;         // number of pixels the RLE records expand to
+    int         colours;        // number of distinct colour indexes used
+    int         decoded;        // 1 decoded ok, 0 failed to decode, -1 not decoded
+} slide_stats_t;
+
+// results for a single file
+typedef struct {
+    const char      *name;
+    int             error;          // non zero if the file could not be read
+    int             num_slides;
+    info_t          *slide_info;
+    slide_stats_t   *stats;
+} file_stats_t;
+
+// per thread histograms
+typedef struct {
+    uint64_t    run_hist[256];      // number of runs of each length
+    uint64_t    pix_hist[256];      // number of pixels of each colour index
+    uint64_t    pal_used[256];      // number of slides using each palette entry
+} thread_hist_t;
+
+typedef struct {
+    file_stats_t    *files;
+    thread_hist_t   *hist;
+    bool            decode;
+} analyze_t;
+
+/// @brief counts the runs in the RLE stream of a single slide, into the slide's stats and
+/// the file's histograms. The records are counted in groups of NSUB into separate
+/// sub-histograms so that consecutive increments don't depend on each other, which
+/// otherwise stalls on repeated run lengths or colours. This is plain scalar code, the
+/// time goes on the scattered increments, and splitting the counts from the values with
+/// SSE2 first measured 20-80% slower than reading the bytes directly.
+static void analyze_rle(memstream_buf_t *src, slide_stats_t *ss, thread_hist_t *th) {
+    uint32_t rh[NSUB][256];
+    uint32_t ph[NSUB][256];
+    memset(rh, 0, sizeof(rh));
+    memset(ph, 0, sizeof(ph));
+
+    const uint8_t *d = src->data;
+    size_t nrec = src->len / 2;
+    size_t i = 0;
+    for(; (i + NSUB) <= nrec; i += NSUB) {
+        const uint8_t *r = &d[i * 2]; // 4 records of count, value
+        uint8_t c0 = r[0], v0 = r[1], c1 = r[2], v1 = r[3];
+        uint8_t c2 = r[4], v2 = r[5], c3 = r[6], v3 = r[7];
+        rh[0][c0]++; ph[0][v0] += c0;
+        rh[1][c1]++; ph[1][v1] += c1;
+        rh[2][c2]++; ph[2][v2] += c2;
+        rh[3][c3]++; ph[3][v3] += c3;
+    }
+    for(; i < nrec; i++) {
+        uint8_t c = d[i * 2];
+        rh[0][c]++;
+        ph[0][d[i * 2 + 1]] += c;
+    }
+
+    // merge the sub-histograms
+    ss->runs = nrec;
+    ss->pixels = 0;
+    ss->colours = 0;
+    for(int v = 0; v < 256; v++) {
+        uint32_t r = rh[0][v] + rh[1][v] + rh[2][v] + rh[3][v];
+        uint32_t p = ph[0][v] + ph[1][v] + ph[2][v] + ph[3][v];
+        th->run_hist[v] += r;
+        th->pix_hist[v] += p;
+        ss->pixels += p;
+        if(p) {
+            ss->colours++;
+            th->pal_used[v]++;
+        }
+    }
+}
+
+/// @brief analyzes a single file, called from the thread pool
+static void analyze_file(void *ctx, size_t index, int thread) {
+    analyze_t *an = ctx;
+    file_stats_t *fs = &an->files[index];
+    thread_hist_t *th = &an->hist[thread];
+    thread_hist_t fh;   // the file's histograms, only added to the thread's once it is all read
+    int fd = -1;
+    uint8_t *img = NULL;
+    memstream_buf_t src = {0, 0, NULL};
+
+    fs->error = -1;
+    memset(&fh, 0, sizeof(fh));
+    if((fd = open(fs->name, O_RDONLY)) < 0) {
+        return;
+    }
+    if(NULL == (fs->slide_info = read_mps_show_info_header_fd(fd, &fs->num_slides))) {
+        goto cleanup;
+    }
+    if(NULL == (fs->stats = calloc(fs->num_slides, sizeof(slide_stats_t)))) {
+        goto cleanup;
+    }
+    if((an->decode) && (NULL == (img = malloc(IMAGE_SIZE)))) {
+        goto cleanup;
+    }
+
+    for(int i = 0; i < fs->num_slides; i++) {
+        slide_stats_t *ss = &fs->stats[i];
+        if(0 != read_mps_show_rle_fd(&src, fd, &fs->slide_info[i])) {
+            goto cleanup;
+        }
+        analyze_rle(&src, ss, &fh);
+        ss->decoded = -1;
+        if(an->decode) {
+            memstream_buf_t dst = {IMAGE_SIZE, 0, img};
+            ss->decoded = ((0 == rle_decompress(&dst, &src)) && (IMAGE_SIZE == dst.pos)) ? 1 : 0;
+        }
+        free_s(src.data);
+    }
+    for(int v = 0; v < 256; v++) {
+        th->run_hist[v] += fh.run_hist[v];
+        th->pix_hist[v] += fh.pix_hist[v];
+        th->pal_used[v] += fh.pal_used[v];
+    }
+    fs->error = 0;
+
+cleanup:
+    free_s(src.data);
+    free_s(img);
+    close(fd);
+}
+
+static void json_array(FILE *fo, const char *name, uint64_t *v, int n, bool last) {
+    fprintf(fo, "  \"%s\": [", name);
+    for(int i = 0; i < n; i++) {
+        fprintf(fo, "%s%llu", (i) ? "," : "", (unsigned long long)v[i]);
+    }
+    fprintf(fo, "]%s\n", (last) ? "" : ",");
+}
+
+int main(int argc, char *argv[]) {
+    int rval = -1;
+    int threads = 0;
+    bool csv = false;
+    analyze_t an;
+    FILE *fo = stdout;
+
+    memset(&an, 0, sizeof(an));
+
+    char *prog = filename(argv[0]);
+    argv++; argc--; // consume the first arg (program name)
+
+    // parse any options, these come before the positional args
+    while((argc) && ('-' == argv[0][0])) {
+        if((0 == strcmp(argv[0], "-t")) && (argc > 1)) {
+            threads = atoi(argv[1]);
+            argv += 2; argc -= 2; // consume the option and its value
+        } else if((0 == strcmp(argv[0], "-f")) && (argc > 1)) {
+            csv = (0 == strcmp(argv[1], "csv"));
+            if((!csv) && (0 != strcmp(argv[1], "json"))) {
+                fprintf(stderr, "ERROR: Unknown format '%s'\n", argv[1]);
+                return -1;
+            }
+            argv += 2; argc -= 2; // consume the option and its value
+        } else if(0 == strcmp(argv[0], "-d")) {
+            an.decode = true;
+            argv++; argc--; // consume the option
+        } else {
+            fprintf(stderr, "ERROR: Unknown option '%s'\n", argv[0]);
+            argc = 0; // force the usage message
+        }
+    }
+
+    if(argc < 1) {
+        printf("MPSanalyze - MPSShow Corpus Statistics\n");
+        printf("USAGE: %s <options> [infile] <infile...>\n", prog);
+        printf("[infile] is the name of an MPS file to analyze, any number may be given\n");
+        printf("<options>\n");
+        printf("  -f [format]  output format, 'json' (default) or 'csv'\n");
+        printf("  -d           also decode every image to check it decodes to a full image\n");
+        printf("  -t [count]   number of threads to use (default is one per processor)\n");
+        return -1;
+    }
+
+    if(threads < 1) threads = parallel_threads();
+    if((NULL == (an.files = calloc(argc, sizeof(file_stats_t)))) ||
+       (NULL == (an.hist = calloc(threads, sizeof(thread_hist_t))))) {
+        fprintf(stderr, "Unable to allocate memory\n");
+        goto CLEANUP;
+    }
+    for(int i = 0; i < argc; i++) {
+        an.files[i].name = argv[i];
+    }
+
+    if(0 != parallel_for(argc, threads, analyze_file, &an)) {
+        fprintf(stderr, "Error: Unable to start threads\n");
+        goto CLEANUP;
+    }
+
+    // merge the per thread histograms
+    thread_hist_t total;
+    memset(&total, 0, sizeof(total));
+    for(int t = 0; t < threads; t++) {
+        for(int v = 0; v < 256; v++) {
+            total.run_hist[v] += an.hist[t].run_hist[v];
+            total.pix_hist[v] += an.hist[t].pix_hist[v];
+            total.pal_used[v] += an.hist[t].pal_used[v];
+        }
+    }
+
+    uint64_t num_slides = 0, num_runs = 0, num_pixels = 0, num_bytes = 0;
+    int num_files = 0;
+    for(int i = 0; i < argc; i++) {
+        file_stats_t *fs = &an.files[i];
+        if(fs->error) {
+            fprintf(stderr, "Error: Unable to read '%s'\n", fs->name);
+            continue;
+        }
+        num_files++;
+        for(int j = 0; j < fs->num_slides; j++) {
+            num_slides++;
+            num_runs += fs->stats[j].runs;
+            num_pixels += fs->stats[j].pixels;
+            num_bytes += fs->slide_info[j].img_len;
+        }
+    }
+
+    if(csv) {
+        fprintf(fo, "file,slide,name,desc,img_offset,img_len,mode,runs,pixels,ratio,colours,decoded\n");
+    } else {
+        fprintf(fo, "{\n  \"slides\": [\n");
+    }
+    bool first = true;
+    for(int i = 0; i < argc; i++) {
+        file_stats_t *fs = &an.files[i];
+        if(fs->error) continue;
+        for(int j = 0; j < fs->num_slides; j++) {
+            info_t *si = &fs->slide_info[j];
+            slide_stats_t *ss = &fs->stats[j];
+            double ratio = (si->img_len) ? (double)ss->pixels / si->img_len : 0.0;
+            if(csv) {
+                csv_str(fo, fs->name, strlen(fs->name));
+                fprintf(fo, ",%d,", j + 1);
+                csv_str(fo, si->name, si->name_len);
+                fputc(',', fo);
+                csv_str(fo, si->desc, si->desc_len);
+                fprintf(fo, ",%u,%u,%u,%u,%u,%.3f,%d,%d\n", si->img_offset, si->img_len, si->mode,
+                    ss->runs, ss->pixels, ratio, ss->colours, ss->decoded);
+            } else {
+                fprintf(fo, "%s    {\"file\": ", (first) ? "" : ",\n");
+                json_str(fo, fs->name, strlen(fs->name));
+                fprintf(fo, ", \"slide\": %d, \"name\": ", j + 1);
+                json_str(fo, si->name, si->name_len);
+                fprintf(fo, ", \"desc\": ");
+                json_str(fo, si->desc, si->desc_len);
+                fprintf(fo, ", \"img_offset\": %u, \"img_len\": %u, \"mode\": %u, \"runs\": %u, \"pixels\": %u, "
+                    "\"ratio\": %.3f, \"colours\": %d", si->img_offset, si->img_len, si->mode,
+                    ss->runs, ss->pixels, ratio, ss->colours);
+                if(ss->decoded >= 0) {
+                    fprintf(fo, ", \"decoded\": %s", (ss->decoded) ? "true" : "false");
+                }
+                fprintf(fo, "}");
+            }
+            first = false;
+        }
+    }
+
+    double ratio = (num_bytes) ? (double)num_pixels / num_bytes : 0.0;
+    double mean_run = (num_runs) ? (double)num_pixels / num_runs : 0.0;
+    if(csv) {
+        // histograms as a second table
+        fprintf(fo, "\nvalue,runs_of_length,pixels_of_colour,slides_using_colour\n");
+        for(int v = 0; v < 256; v++) {
+            fprintf(fo, "%d,%llu,%llu,%llu\n", v, (unsigned long long)total.run_hist[v],
+                (unsigned long long)total.pix_hist[v], (unsigned long long)total.pal_used[v]);
+        }
+    } else {
+        fprintf(fo, "\n  ],\n");
+        fprintf(fo, "  \"files\": %d,\n  \"num_slides\": %llu,\n  \"runs\": %llu,\n  \"pixels\": %llu,\n"
+            "  \"compressed_bytes\": %llu,\n  \"ratio\": %.3f,\n  \"mean_run_length\": %.3f,\n",
+            num_files, (unsigned long long)num_slides, (unsigned long long)num_runs,
+            (unsigned long long)num_pixels, (unsigned long long)num_bytes, ratio, mean_run);
+        json_array(fo, "run_length_histogram", total.run_hist, 256, false);
+        json_array(fo, "colour_histogram", total.pix_hist, 256, false);
+        json_array(fo, "palette_used", total.pal_used, 256, true);
+        fprintf(fo, "}\n");
+    }
+    rval = 0; // clean exit
+
+CLEANUP:
+    if(an.files) {
+        for(int i = 0; i < argc; i++) {
+            free_s(an.files[i].slide_info);
+            free_s(an.files[i].stats);
+        }
+    }
+    free_s(an.files);
+    free_s(an.hist);
+    return rval;
+}
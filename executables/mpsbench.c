@@ -0,0 +1,185 @@
+/*
+ * MPSbench.c
+ * Measures the end to end throughput of one of the command line tools. The command is
+ * run a number of times, each in its own process, and the elapsed time and the peak
+ * memory use of the processes are reported, along with the throughput in MB/s of input
+ * and slides/s.
+ *
+ * The results can be appended to a CSV file to track them over time, and a minimum
+ * throughput can be given so that a regression makes this fail, e.g. from CTest.
+ *
+ * This code is offered without warranty under the MIT License. Use it as you will
+ * personally or commercially, just give credit if you do.
+ */
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "util.h"
+
+#define DEF_RUNS (3)
+
+/// @brief runs the command once, and waits for it to finish
+/// @param cmd the command and its arguments, NULL terminated
+/// @param quiet discard the output of the command
+/// @param seconds pointer to hold the elapsed time
+/// @param ru pointer to hold the resource use of the process
+/// @return 0 if the command ran and exited with a status of 0
+static int run_once(char **cmd, bool quiet, double *seconds, struct rusage *ru) {
+    struct timespec t0, t1;
+    int status = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    pid_t pid = fork();
+    if(pid < 0) {
+        return -1;
+    }
+    if(0 == pid) { // the child
+        if(quiet) {
+            int fd = open("/dev/null", O_WRONLY);
+            if(fd >= 0) {
+                dup2(fd, STDOUT_FILENO);
+                dup2(fd, STDERR_FILENO);
+                close(fd);
+            }
+        }
+        execvp(cmd[0], cmd);
+        _exit(127); // only returns if the command could not be run
+    }
+    if(pid != wait4(pid, &status, 0, ru)) {
+        return -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    *seconds = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    return (WIFEXITED(status) && (0 == WEXITSTATUS(status))) ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+    int runs = DEF_RUNS;
+    char *name = NULL;
+    char *csv_name = NULL;
+    char *input = NULL;
+    double min_mbs = 0.0;
+    long slides = 0;
+    bool quiet = true;
+
+    printf("MPSbench - MPSShow Tool Benchmark\n");
+
+    char *prog = filename(argv[0]);
+    argv++; argc--; // consume the first arg (program name)
+
+    // parse any options, these come before the command, which may follow a '--'
+    while((argc) && ('-' == argv[0][0])) {
+        if(0 == strcmp(argv[0], "--")) {
+            argv++; argc--; // consume the separator
+            break;
+        } else if((0 == strcmp(argv[0], "-n")) && (argc > 1)) {
+            runs = atoi(argv[1]);
+            argv += 2; argc -= 2; // consume the option and its value
+        } else if((0 == strcmp(argv[0], "-i")) && (argc > 1)) {
+            input = argv[1];
+            argv += 2; argc -= 2; // consume the option and its value
+        } else if((0 == strcmp(argv[0], "-s")) && (argc > 1)) {
+            slides = atol(argv[1]);
+            argv += 2; argc -= 2; // consume the option and its value
+        } else if((0 == strcmp(argv[0], "-l")) && (argc > 1)) {
+            name = argv[1];
+            argv += 2; argc -= 2; // consume the option and its value
+        } else if((0 == strcmp(argv[0], "-o")) && (argc > 1)) {
+            csv_name = argv[1];
+            argv += 2; argc -= 2; // consume the option and its value
+        } else if((0 == strcmp(argv[0], "-m")) && (argc > 1)) {
+            min_mbs = atof(argv[1]);
+            argv += 2; argc -= 2; // consume the option and its value
+        } else if(0 == strcmp(argv[0], "-v")) {
+            quiet = false;
+            argv++; argc--; // consume the option
+        } else {
+            printf("ERROR: Unknown option '%s'\n", argv[0]);
+            argc = 0; // force the usage message
+        }
+    }
+
+    if((argc < 1) || (runs < 1)) {
+        printf("USAGE: %s <options> -- [command] <args...>\n", prog);
+        printf("[command] is the tool to run, with its arguments\n");
+        printf("<options>\n");
+        printf("  -n [count]   number of times to run the command (default %d)\n", DEF_RUNS);
+        printf("  -i [file]    the input file, its size is used for the MB/s figure\n");
+        printf("  -s [count]   number of slides each run processes, for the slides/s figure\n");
+        printf("  -l [label]   name for the results (default is the command name)\n");
+        printf("  -o [file]    append the results to a CSV file\n");
+        printf("  -m [MB/s]    fail if the throughput is below this\n");
+        printf("  -v           show the output of the command\n");
+        return -1;
+    }
+    if(NULL == name) {
+        name = filename(argv[0]);
+    }
+
+    uint64_t in_size = 0;
+    if(input) {
+        struct stat st;
+        if(0 != stat(input, &st)) {
+            printf("Error: Unable to read input file '%s'\n", input);
+            return -1;
+        }
+        in_size = st.st_size;
+    }
+
+    // argv is already NULL terminated, so it can be used directly for the command
+    double total = 0.0, best = 0.0;
+    long peak_rss = 0;
+    for(int i = 0; i < runs; i++) {
+        double seconds = 0.0;
+        struct rusage ru;
+        memset(&ru, 0, sizeof(ru));
+        if(0 != run_once(argv, quiet, &seconds, &ru)) {
+            printf("Error: '%s' failed on run %d\n", argv[0], i + 1);
+            return -1;
+        }
+        total += seconds;
+        if((0 == i) || (seconds < best)) best = seconds;
+        if(ru.ru_maxrss > peak_rss) peak_rss = ru.ru_maxrss;
+    }
+
+#if defined(__APPLE__)
+    peak_rss /= 1024; // reported in bytes rather than KB
+#endif
+    double mean = total / runs;
+    double mbs = (in_size) ? (in_size / (1024.0 * 1024.0)) / mean : 0.0;
+    double sps = (slides) ? slides / mean : 0.0;
+    printf("%s: %d runs  mean %.4fs  best %.4fs", name, runs, mean, best);
+    if(in_size) printf("  %.1f MB/s", mbs);
+    if(slides) printf("  %.1f slides/s", sps);
+    printf("  peak RSS %ld KB\n", peak_rss);
+
+    if(csv_name) {
+        FILE *fo = fopen(csv_name, "a");
+        if(NULL == fo) {
+            printf("Error: Unable to open '%s'\n", csv_name);
+            return -1;
+        }
+        if(0 == ftell(fo)) {
+            fprintf(fo, "name,runs,mean_s,best_s,input_bytes,mb_s,slides_s,peak_rss_kb,time\n");
+        }
+        fprintf(fo, "%s,%d,%.6f,%.6f,%llu,%.3f,%.3f,%ld,%lld\n", name, runs, mean, best,
+            (unsigned long long)in_size, mbs, sps, peak_rss, (long long)time(NULL));
+        fclose(fo);
+    }
+
+    if((min_mbs > 0.0) && (mbs < min_mbs)) {
+        printf("FAIL: %.1f MB/s is below the minimum of %.1f MB/s\n", mbs, min_mbs);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,388 @@
+/*
+ * MPScarve.c
+ * Scans an arbitrary file (raw floppy or hard disk images, concatenated archives, etc.)
+ * for MPSShow data, and lists, or optionally extracts, any that are found.
+ *
+ * Unlike 'MPSextract' this does not need the MPSShow data to be appended to an EXE.
+ * Every position in the file where an info_t record could start is checked against
+ * the structural invariants of the info block
+ *   - name_len <= 9, and desc_len <= 25
+ *   - mode == 0x13
+ *   - all palette components <= 63
+ *   - img_offset increases from slide to slide, without the images overlapping
+ *   - all the images fit within the file
+ * The file is memory mapped and split into chunks that are scanned in parallel, a
+ * SIMD prefilter quickly skips over positions that can't be the start of a record.
+ *
+ * This code is offered without warranty under the MIT License. Use it as you will
+ * personally or commercially, just give credit if you do.
+ */
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "util.h"
+#include "mps-show.h"
+#include "parallel.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define OUTEXT   ".MPS"   // default extension for the output file
+#define CHUNKSZ  (1 << 22)  // size of each chunk of the file scanned by a thread (4MB)
+#define MODE_OFS (41)     // offset from the slide count to the mode field of the first record
+
+// offsets of the fields within an info_t record
+#define REC_NAME_LEN   (0)
+#define REC_DESC_LEN   (10)
+#define REC_IMG_OFFSET (36)
+#define REC_MODE       (40)
+#define REC_IMG_LEN    (42)
+#define REC_PAL        (48)
+
+// a found MPSShow payload
+typedef struct {
+    size_t      pos;        // position of the slide count byte in the file
+    size_t      end;        // position just past the end of the last image
+    int         slides;     // number of slides
+    int64_t     base;       // position in the file that img_offset values are relative to
+} carve_t;
+
+typedef struct {
+    const uint8_t   *data;      // the mapped file
+    size_t          size;       // size of the file
+    size_t          chunks;     // number of chunks
+    pthread_mutex_t lock;       // protects the found list
+    carve_t         *found;     // list of payloads found
+    size_t          num_found;
+    size_t          max_found;
+} scan_t;
+
+static inline uint16_t rd16(const uint8_t *p) {
+    return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t rd32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/// @brief checks all the invariants for MPSShow data starting at 'pos'
+/// @param sc the scan state
+/// @param pos position of the candidate slide count byte
+/// @param res pointer to hold the details of the payload
+/// @return true if the data looks like a valid MPSShow payload
+static bool carve_check(scan_t *sc, size_t pos, carve_t *res) {
+    const uint8_t *d = sc->data;
+    int count = d[pos];
+    if(0 == count) {
+        return false;
+    }
+
+    size_t hdr_sz = 1 + (size_t)count * MPSRECSZ;
+    if((pos + hdr_sz) > sc->size) {
+        return false;
+    }
+
+    const uint8_t *rec = &d[pos + 1];
+    uint32_t first_ofs = rd32(&rec[REC_IMG_OFFSET]);
+    if(first_ofs < hdr_sz) { // image data can't come before the end of the info block
+        return false;
+    }
+    int64_t base = (int64_t)(pos + hdr_sz) - first_ofs;
+
+    uint64_t next = first_ofs;
+    for(int i = 0; i < count; i++, rec += MPSRECSZ) {
+        if((rec[REC_NAME_LEN] > 9) || (rec[REC_DESC_LEN] > 25) || (0x13 != rd16(&rec[REC_MODE]))) {
+            return false;
+        }
+        uint32_t ofs = rd32(&rec[REC_IMG_OFFSET]);
+        uint16_t len = rd16(&rec[REC_IMG_LEN]);
+        if((ofs < next) || (0 == len)) { // must increase, and not overlap the previous image
+            return false;
+        }
+        next = (uint64_t)ofs + len;
+        if((base + (int64_t)next) > (int64_t)sc->size) { // must fit in the file
+            return false;
+        }
+
+        // all palette components must be in the VGA range of 0-63
+        uint8_t bits = 0;
+        for(int j = 0; j < (int)(sizeof(pal_entry_t) * 256); j++) {
+            bits |= rec[REC_PAL + j];
+        }
+        if(bits & 0xc0) {
+            return false;
+        }
+    }
+
+    res->pos = pos;
+    res->end = base + next;
+    res->slides = count;
+    res->base = base;
+    return true;
+}
+
+static void carve_add(scan_t *sc, carve_t *res) {
+    pthread_mutex_lock(&sc->lock);
+    if(sc->num_found == sc->max_found) {
+        size_t n = (sc->max_found) ? sc->max_found * 2 : 64;
+        carve_t *f = realloc(sc->found, n * sizeof(carve_t));
+        if(NULL == f) {
+            pthread_mutex_unlock(&sc->lock);
+            return;
+        }
+        sc->found = f;
+        sc->max_found = n;
+    }
+    sc->found[sc->num_found++] = *res;
+    pthread_mutex_unlock(&sc->lock);
+}
+
+/// @brief checks a candidate whose first mode field is at 'q'
+static inline void carve_candidate(scan_t *sc, size_t q) {
+    carve_t res;
+    if(carve_check(sc, q - MODE_OFS, &res)) {
+        carve_add(sc, &res);
+    }
+}
+
+/// @brief scans one chunk of the file, the chunk owns the candidate positions within it,
+/// but the checks read past the end of the chunk as needed, so payloads that cross a
+/// chunk boundary are found by the chunk they start in
+static void carve_chunk(void *ctx, size_t index, int thread) {
+    (void)thread;
+    scan_t *sc = ctx;
+    const uint8_t *d = sc->data;
+
+    // q is the position of the candidate mode field (0x13 0x00) of the first record
+    size_t q = index * CHUNKSZ;
+    size_t end = q + CHUNKSZ;
+    if(end > sc->size) end = sc->size;
+    if(q < MODE_OFS) q = MODE_OFS;
+
+    // prefilter for the mode field of the first record, along with the name_len and
+    // desc_len limits of that record
+#if defined(__AVX2__)
+    const __m256i v13 = _mm256_set1_epi8(0x13);
+    const __m256i v00 = _mm256_setzero_si256();
+    const __m256i v09 = _mm256_set1_epi8(9);
+    const __m256i v25 = _mm256_set1_epi8(25);
+    for(; ((q + 32) <= end) && ((q + 33) <= sc->size); q += 32) {
+        __m256i mlo = _mm256_loadu_si256((const __m256i *)&d[q]);
+        __m256i mhi = _mm256_loadu_si256((const __m256i *)&d[q + 1]);
+        __m256i nl = _mm256_loadu_si256((const __m256i *)&d[q - REC_MODE]);
+        __m256i dl = _mm256_loadu_si256((const __m256i *)&d[q - REC_MODE + REC_DESC_LEN]);
+        __m256i m = _mm256_and_si256(_mm256_cmpeq_epi8(mlo, v13), _mm256_cmpeq_epi8(mhi, v00));
+        m = _mm256_and_si256(m, _mm256_cmpeq_epi8(_mm256_subs_epu8(nl, v09), v00));
+        m = _mm256_and_si256(m, _mm256_cmpeq_epi8(_mm256_subs_epu8(dl, v25), v00));
+        uint32_t bits = _mm256_movemask_epi8(m);
+        while(bits) {
+            carve_candidate(sc, q + __builtin_ctz(bits));
+            bits &= bits - 1;
+        }
+    }
+#elif defined(__SSE2__)
+    const __m128i v13 = _mm_set1_epi8(0x13);
+    const __m128i v00 = _mm_setzero_si128();
+    const __m128i v09 = _mm_set1_epi8(9);
+    const __m128i v25 = _mm_set1_epi8(25);
+    for(; ((q + 16) <= end) && ((q + 17) <= sc->size); q += 16) {
+        __m128i mlo = _mm_loadu_si128((const __m128i *)&d[q]);
+        __m128i mhi = _mm_loadu_si128((const __m128i *)&d[q + 1]);
+        __m128i nl = _mm_loadu_si128((const __m128i *)&d[q - REC_MODE]);
+        __m128i dl = _mm_loadu_si128((const __m128i *)&d[q - REC_MODE + REC_DESC_LEN]);
+        __m128i m = _mm_and_si128(_mm_cmpeq_epi8(mlo, v13), _mm_cmpeq_epi8(mhi, v00));
+        m = _mm_and_si128(m, _mm_cmpeq_epi8(_mm_subs_epu8(nl, v09), v00));
+        m = _mm_and_si128(m, _mm_cmpeq_epi8(_mm_subs_epu8(dl, v25), v00));
+        uint32_t bits = _mm_movemask_epi8(m);
+        while(bits) {
+            carve_candidate(sc, q + __builtin_ctz(bits));
+            bits &= bits - 1;
+        }
+    }
+#endif
+    // scalar tail, or the whole chunk without SIMD
+    while(q < end) {
+        const uint8_t *p = memchr(&d[q], 0x13, end - q);
+        if(NULL == p) {
+            break;
+        }
+        q = p - d;
+        if(((q + 1) < sc->size) && (0 == d[q + 1]) && (d[q - REC_MODE] <= 9) && (d[q - REC_MODE + REC_DESC_LEN] <= 25)) {
+            carve_candidate(sc, q);
+        }
+        q++;
+    }
+}
+
+static int carve_compare(const void *a, const void *b) {
+    const carve_t *ca = a;
+    const carve_t *cb = b;
+    return (ca->pos > cb->pos) - (ca->pos < cb->pos);
+}
+
+/// @brief writes out a carved payload as an MPS file, with the image offsets made
+/// relative to the start of the new file, the same as 'MPSextract' does
+static int carve_extract(scan_t *sc, carve_t *res, const char *fo_name) {
+    int rval = -1;
+    FILE *fo = NULL;
+    size_t hdr_sz = 1 + (size_t)res->slides * MPSRECSZ;
+    info_t *slide_info = NULL;
+
+    if(NULL == (slide_info = calloc(res->slides, sizeof(info_t)))) {
+        goto cleanup;
+    }
+    memcpy(slide_info, &sc->data[res->pos + 1], res->slides * sizeof(info_t));
+    // rebase the slide offsets to be relative to the new MPS file
+    for(int i = 0; i < res->slides; i++) {
+        slide_info[i].img_offset = (uint32_t)(res->base + slide_info[i].img_offset - res->pos);
+    }
+
+    if(NULL == (fo = fopen(fo_name, "wb"))) {
+        goto cleanup;
+    }
+    fputc(res->slides, fo);
+    if(res->slides != (int)fwrite(slide_info, sizeof(info_t), res->slides, fo)) {
+        goto cleanup;
+    }
+    size_t len = res->end - (res->pos + hdr_sz);
+    if(1 != fwrite(&sc->data[res->pos + hdr_sz], len, 1, fo)) {
+        goto cleanup;
+    }
+    rval = 0;
+
+cleanup:
+    fclose_s(fo);
+    free_s(slide_info);
+    return rval;
+}
+
+int main(int argc, char *argv[]) {
+    int rval = -1;
+    int fd = -1;
+    int threads = 0;
+    bool extract = false;
+    char *fi_name = NULL;
+    char *fo_name = NULL;
+    void *map = MAP_FAILED;
+    scan_t sc;
+
+    memset(&sc, 0, sizeof(sc));
+    pthread_mutex_init(&sc.lock, NULL);
+
+    printf("MPScarve - MPSShow Data Carver\n");
+
+    char *prog = filename(argv[0]);
+    argv++; argc--; // consume the first arg (program name)
+
+    // parse any options, these come before the positional args
+    while((argc) && ('-' == argv[0][0])) {
+        if((0 == strcmp(argv[0], "-t")) && (argc > 1)) {
+            threads = atoi(argv[1]);
+            argv += 2; argc -= 2; // consume the option and its value
+        } else if(0 == strcmp(argv[0], "-x")) {
+            extract = true;
+            argv++; argc--; // consume the option
+        } else {
+            printf("ERROR: Unknown option '%s'\n", argv[0]);
+            argc = 0; // force the usage message
+        }
+    }
+
+    if(1 != argc) {
+        printf("USAGE: %s <options> [infile]\n", prog);
+        printf("[infile] is the name of the disk image, archive, or other file to scan\n");
+        printf("<options>\n");
+        printf("  -t [count]  number of threads to scan with (default is one per processor)\n");
+        printf("  -x          extract the data found to '%s' files, named for infile and the position\n", OUTEXT);
+        return -1;
+    }
+    fi_name = argv[0];
+
+    // open and map the input file
+    printf("Opening File: '%s'", fi_name);
+    if((fd = open(fi_name, O_RDONLY)) < 0) {
+        printf("\tError: Unable to open input file\n");
+        goto CLEANUP;
+    }
+    struct stat st;
+    if(0 != fstat(fd, &st)) {
+        printf("\tError: Unable to determine file size\n");
+        goto CLEANUP;
+    }
+    sc.size = st.st_size;
+    printf("\tFile Size: %zu\n", sc.size);
+    if(sc.size <= (1 + MPSRECSZ)) {
+        printf("File too small to contain MPSShow data\n");
+        goto DONE;
+    }
+    if(MAP_FAILED == (map = mmap(NULL, sc.size, PROT_READ, MAP_PRIVATE, fd, 0))) {
+        printf("Error: Unable to map input file\n");
+        goto CLEANUP;
+    }
+    madvise(map, sc.size, MADV_SEQUENTIAL);
+    sc.data = map;
+
+    // scan all the chunks in parallel
+    sc.chunks = (sc.size + CHUNKSZ - 1) / CHUNKSZ;
+    if(0 != parallel_for(sc.chunks, threads, carve_chunk, &sc)) {
+        printf("Error: Unable to start scanning threads\n");
+        goto CLEANUP;
+    }
+
+    // report in file order, dropping matches that fall inside an earlier payload
+    // (e.g. a later info record of the same payload that also passes the checks)
+    qsort(sc.found, sc.num_found, sizeof(carve_t), carve_compare);
+    size_t last_end = 0;
+    int num_payloads = 0;
+    for(size_t i = 0; i < sc.num_found; i++) {
+        carve_t *res = &sc.found[i];
+        if((num_payloads) && (res->pos < last_end)) {
+            continue;
+        }
+        last_end = res->end;
+        num_payloads++;
+
+        const info_t *first = (const info_t *)&sc.data[res->pos + 1];
+        printf("%2d: ofs:%010zx size:%-8zu slides:%-3d first: %.*s\n", num_payloads,
+            res->pos, res->end - res->pos, res->slides, first->name_len, first->name);
+
+        if(extract) {
+            free_s(fo_name);
+            size_t namelen = strlen(filename(fi_name)) + 32;
+            if(NULL == (fo_name = calloc(1, namelen))) {
+                printf("Unable to allocate memory\n");
+                goto CLEANUP;
+            }
+            snprintf(fo_name, namelen, "%s", filename(fi_name));
+            drop_extension(fo_name);
+            snprintf(&fo_name[strlen(fo_name)], 32, "-%010zx%s", res->pos, OUTEXT);
+            printf("    Saving: '%s'\n", fo_name);
+            if(0 != carve_extract(&sc, res, fo_name)) {
+                printf("Error: Unable to save MPS data\n");
+                goto CLEANUP;
+            }
+        }
+    }
+    printf("Found %d MPSShow payload%s\n", num_payloads, (1 == num_payloads) ? "" : "s");
+
+DONE:
+    rval = 0; // clean exit
+
+CLEANUP:
+    if(MAP_FAILED != map) munmap(map, sc.size);
+    if(fd >= 0) close(fd);
+    free_s(sc.found);
+    free_s(fo_name);
+    return rval;
+}
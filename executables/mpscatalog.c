@@ -0,0 +1,243 @@
+/*
+ * MPScatalog.c
+ * Builds a catalog of every slide in a set of MPSShow data files (.MPS), one record per
+ * slide with its name, description, image offset and length, mode, the unknown 32 bit
+ * field, a CRC-32C of its palette, and the file it came from. The catalog is written as
+ * newline delimited JSON (one object per line) or CSV, ready to be loaded into a database.
+ *
+ * Only the slide count and the info block of each file are read, with a single positional
+ * read per file of the count and the records of up to PREFIX_SLIDES slides, and a second
+ * read only for the rest of a larger info block. Files are processed in parallel, each
+ * into its own memory buffer, and the buffers are written out in the order the files
+ * were given.
+ *
+ * To obtain the .MPS file you can use 'MPSextract' on a MPSShow slideshow demo exe file
+ *
+ * This code is offered without warranty under the MIT License. Use it as you will
+ * personally or commercially, just give credit if you do.
+ */
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "util.h"
+#include "mps-show.h"
+#include "crc32c.h"
+#include "parallel.h"
+
+#define PREFIX_SLIDES (8)   // slides whose records are read along with the count
+
+// catalog of a single file
+typedef struct {
+    const char  *name;
+    const char  *error;       // reason the file could not be catalogued, NULL if ok
+    int         num_slides;
+    char        *out;         // formatted records
+    size_t      out_len;
+} entry_t;
+
+typedef struct {
+    entry_t     *entries;
+    bool        csv;
+} catalog_t;
+
+/// @brief reads up to 'len' bytes at 'offset', stopping early only at the end of the file
+/// @return number of bytes read, -1 on error
+static ssize_t pread_upto(int fd, uint8_t *buf, size_t len, off_t offset) {
+    size_t total = 0;
+    while(total < len) {
+        ssize_t nr = pread(fd, &buf[total], len - total, offset + total);
+        if(nr < 0) {
+            if(EINTR == errno) continue;
+            return -1;
+        }
+        if(0 == nr) break; // end of file
+        total += nr;
+    }
+    return total;
+}
+
+/// @brief catalogs a single file, called from the thread pool
+static void catalog_file(void *ctx, size_t index, int thread) {
+    (void)thread;
+    catalog_t *cat = ctx;
+    entry_t *e = &cat->entries[index];
+    uint8_t *hdr = NULL;
+    FILE *fo = NULL;
+    int fd = -1;
+
+    if((fd = open(e->name, O_RDONLY)) < 0) {
+        e->error = "unable to open file";
+        goto cleanup;
+    }
+
+    // the count and the first few records in one read, enough for most shows
+    size_t prefix_len = 1 + PREFIX_SLIDES * MPSRECSZ;
+    if(NULL == (hdr = malloc(prefix_len))) {
+        e->error = "out of memory";
+        goto cleanup;
+    }
+    ssize_t nr = pread_upto(fd, hdr, prefix_len, 0);
+    if(nr < 0) {
+        e->error = "read error";
+        goto cleanup;
+    }
+    if((nr < 1) || (0 == hdr[0])) {
+        e->error = "no slides";
+        goto cleanup;
+    }
+    e->num_slides = hdr[0];
+
+    // then the rest of the info block, if it is larger
+    size_t hdr_len = 1 + (size_t)e->num_slides * MPSRECSZ;
+    if((hdr_len > prefix_len) && ((size_t)nr == prefix_len)) {
+        uint8_t *full = realloc(hdr, hdr_len);
+        if(NULL == full) {
+            e->error = "out of memory";
+            goto cleanup;
+        }
+        hdr = full;
+        ssize_t more = pread_upto(fd, &hdr[prefix_len], hdr_len - prefix_len, prefix_len);
+        if(more < 0) {
+            e->error = "read error";
+            goto cleanup;
+        }
+        nr += more;
+    }
+    if((size_t)nr < hdr_len) {
+        e->error = "info block truncated";
+        goto cleanup;
+    }
+
+    if(NULL == (fo = open_memstream(&e->out, &e->out_len))) {
+        e->error = "out of memory";
+        goto cleanup;
+    }
+    info_t *slide_info = (info_t *)&hdr[1];
+    for(int i = 0; i < e->num_slides; i++) {
+        info_t *si = &slide_info[i];
+        uint32_t pal_crc = crc32c(0, si->pal, sizeof(si->pal));
+        if(cat->csv) {
+            csv_str(fo, e->name, strlen(e->name));
+            fprintf(fo, ",%d,", i + 1);
+            csv_str(fo, si->name, si->name_len);
+            fputc(',', fo);
+            csv_str(fo, si->desc, si->desc_len);
+            fprintf(fo, ",%u,%u,%u,%08x,%08x\n", si->img_offset, si->img_len, si->mode, si->unknown32, pal_crc);
+        } else {
+            fprintf(fo, "{\"file\": ");
+            json_str(fo, e->name, strlen(e->name));
+            fprintf(fo, ", \"slide\": %d, \"name\": ", i + 1);
+            json_str(fo, si->name, si->name_len);
+            fprintf(fo, ", \"desc\": ");
+            json_str(fo, si->desc, si->desc_len);
+            fprintf(fo, ", \"img_offset\": %u, \"img_len\": %u, \"mode\": %u, \"unknown32\": \"%08x\", \"pal_crc\": \"%08x\"}\n",
+                si->img_offset, si->img_len, si->mode, si->unknown32, pal_crc);
+        }
+    }
+    if(0 != fclose(fo)) {
+        e->error = "out of memory";
+    }
+    fo = NULL;
+
+cleanup:
+    if(fo) fclose(fo);
+    if(fd >= 0) close(fd);
+    free_s(hdr);
+}
+
+int main(int argc, char *argv[]) {
+    int rval = -1;
+    int threads = 0;
+    catalog_t cat = {NULL, false};
+    char *fo_name = NULL;
+    FILE *fo = stdout;
+
+    char *prog = filename(argv[0]);
+    argv++; argc--; // consume the first arg (program name)
+
+    // parse any options, these come before the positional args
+    while((argc) && ('-' == argv[0][0])) {
+        if((0 == strcmp(argv[0], "-t")) && (argc > 1)) {
+            threads = atoi(argv[1]);
+            argv += 2; argc -= 2; // consume the option and its value
+        } else if((0 == strcmp(argv[0], "-f")) && (argc > 1)) {
+            cat.csv = (0 == strcmp(argv[1], "csv"));
+            if((!cat.csv) && (0 != strcmp(argv[1], "ndjson"))) {
+                fprintf(stderr, "ERROR: Unknown format '%s'\n", argv[1]);
+                return -1;
+            }
+            argv += 2; argc -= 2; // consume the option and its value
+        } else if((0 == strcmp(argv[0], "-o")) && (argc > 1)) {
+            fo_name = argv[1];
+            argv += 2; argc -= 2; // consume the option and its value
+        } else {
+            fprintf(stderr, "ERROR: Unknown option '%s'\n", argv[0]);
+            argc = 0; // force the usage message
+        }
+    }
+
+    if(argc < 1) {
+        printf("MPScatalog - MPSShow Slide Catalog Builder\n");
+        printf("USAGE: %s <options> [infile] <infile...>\n", prog);
+        printf("[infile] is the name of an MPS file to catalog, any number may be given\n");
+        printf("<options>\n");
+        printf("  -f [format]  output format, 'ndjson' (default) or 'csv'\n");
+        printf("  -o [file]    write the catalog to a file instead of stdout\n");
+        printf("  -t [count]   number of threads to use (default is one per processor)\n");
+        return -1;
+    }
+
+    if(NULL == (cat.entries = calloc(argc, sizeof(entry_t)))) {
+        fprintf(stderr, "Unable to allocate memory\n");
+        goto CLEANUP;
+    }
+    for(int i = 0; i < argc; i++) {
+        cat.entries[i].name = argv[i];
+    }
+    if((fo_name) && (NULL == (fo = fopen(fo_name, "w")))) {
+        fprintf(stderr, "Error: Unable to create '%s'\n", fo_name);
+        goto CLEANUP;
+    }
+
+    if(0 != parallel_for(argc, threads, catalog_file, &cat)) {
+        fprintf(stderr, "Error: Unable to start threads\n");
+        goto CLEANUP;
+    }
+
+    // output in the order the files were given
+    int num_files = 0, num_slides = 0;
+    if(cat.csv) {
+        fprintf(fo, "file,slide,name,desc,img_offset,img_len,mode,unknown32,pal_crc\n");
+    }
+    for(int i = 0; i < argc; i++) {
+        entry_t *e = &cat.entries[i];
+        if(e->error) {
+            fprintf(stderr, "Error: '%s' %s\n", e->name, e->error);
+            continue;
+        }
+        fwrite(e->out, 1, e->out_len, fo);
+        num_files++;
+        num_slides += e->num_slides;
+    }
+    if(0 != fflush(fo)) {
+        fprintf(stderr, "Error: Unable to write catalog\n");
+        goto CLEANUP;
+    }
+    fprintf(stderr, "Catalogued %d slides from %d of %d files\n", num_slides, num_files, argc);
+    rval = (num_files == argc) ? 0 : 1;
+
+CLEANUP:
+    if((fo) && (fo != stdout)) fclose(fo);
+    if(cat.entries) {
+        for(int i = 0; i < argc; i++) {
+            free_s(cat.entries[i].out);
+        }
+    }
+    free_s(cat.entries);
+    return rval;
+}
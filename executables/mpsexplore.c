@@ -14,14 +14,72 @@
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
+#include <time.h>
 #include "util.h"
 #include "mps-show.h"
+#include "mps-plan.h"
 #include "pal-tools.h"
 #include "bmp.h"
+#include "scale.h"
+#include "tar.h"
+#include "crc32c.h"
+#include "manifest.h"
 
 #define OUTEXT   ".BMP"   // default extension for the output file
 #define IMAGE_WIDTH (320)
 #define IMAGE_HEIGHT (200)
+#define PALEXT   ".PAL"   // extension for palettes written to a tar stream
+#define TARBUFSZ (1 << 20) // size of the output buffer for the tar stream
+
+/// @brief writes a slide to the tar stream as a BMP, and optionally its palette as a PAL
+/// @param fo the tar output stream
+/// @param th header template for the tar entries
+/// @param bmp buffer to encode the BMP into
+/// @param img the image to write
+/// @param width width of the image
+/// @param height height of the image
+/// @param slide the slide record for the image, its palette is still 6-bit/component
+/// @param pal true to also write the palette
+/// @return 0 on success
+static int tar_slide(FILE *fo, tar_header_t *th, memstream_buf_t *bmp, memstream_buf_t *img, 
+                     uint16_t width, uint16_t height, info_t *slide, bool pal) {
+    char name[32];
+
+    if(pal) { // write the palette as is, the same as palextract
+        snprintf(name, sizeof(name), "%.*s%s", slide->name_len, slide->name, PALEXT);
+        if(0 != tar_write_entry(fo, th, name, slide->pal, sizeof(pal_entry_t) * 256)) {
+            return -1;
+        }
+    }
+
+    // convert from 6-bit/component (VGA) to 8-bit/component (BMP)
+    pal_entry_t pal8[256];
+    pal6_to_pal8(slide->pal, pal8, 256);
+    bmp->pos = 0;
+    if(0 != encode_bmp(bmp, img, width, height, pal8)) {
+        return -1;
+    }
+    snprintf(name, sizeof(name), "%.*s%s", slide->name_len, slide->name, OUTEXT);
+    return tar_write_entry(fo, th, name, bmp->data, bmp->pos);
+}
+
+/// @brief writes a BMP file already encoded in memory, and records it in the manifest
+/// @return 0 on success
+static int save_recorded(manifest_t *man, const char *fn, memstream_buf_t *bmp) {
+    FILE *fp = NULL;
+    if(NULL == (fp = fopen(fn, "wb"))) {
+        return -1;
+    }
+    size_t nw = fwrite(bmp->data, 1, bmp->pos, fp);
+    if((0 != fclose(fp)) || (nw != bmp->pos)) {
+        return -1;
+    }
+    manifest_entry_t e = {(char *)fn, 0, 0, crc32c(0, bmp->data, bmp->pos)};
+    if(0 != manifest_stat(&e)) {
+        return -1;
+    }
+    return manifest_add(man, &e);
+}
 
 int main(int argc, char *argv[]) {
     int rval = -1;
@@ -30,26 +88,85 @@ int main(int argc, char *argv[]) {
     char *fi_name = NULL;
     char *fo_name = NULL;
     int xtridx  = -1;
+    int scale = SCALE_NONE;
     info_t *slide_info = NULL;
+    mps_plan_t *plan = NULL;
     memstream_buf_t img = {0, 0, NULL};
+    memstream_buf_t scaled = {0, 0, NULL};
+    memstream_buf_t bmp = {0, 0, NULL};
+    FILE *con = stdout;     // console for messages, stderr if the output goes to stdout
+    char *tar_name = NULL;  // name of the tar file to write to, if any
+    bool tar_pal = false;   // include the palettes in the tar file
+    tar_header_t th;
+    char *man_name = NULL;  // name of the manifest for incremental extraction, if any
+    manifest_t man;
+    bool man_open = false;
+    bool man_verify = false; // check the contents of recorded images, not just their size and time
+    uint8_t *want = NULL;   // slides that need to be extracted
+    int num_bad = 0;        // images that could not be read
+
+    // if a tar stream is going to stdout, keep our messages out of it
+    for(int i = 1; i < (argc - 1); i++) {
+        if((0 == strcmp(argv[i], "-T")) && (0 == strcmp(argv[i + 1], "-"))) {
+            con = stderr;
+        }
+    }
 
-    printf("MPSextract - MPSShow Image Extractor\n");
+    fprintf(con, "MPSextract - MPSShow Image Extractor\n");
 
-    if((argc < 2) || (argc > 4)) {
-        printf("USAGE: %s [infile] <extract> <outfile>\n", filename(argv[0]));
-        printf("[infile] is the name of the input MPS file to extract from\n");
-        printf("<extract> is the optional numerical index of the image to extract\n");
-        printf("if <extract> is omitted, a listing of assets will be printed.\n");
-        printf("A value of 0 for <extract> will call all image to be extracted.\n");
-        printf("<outfile> optinal name for the output file, ignored if <extract> is 0\n");
+    char *prog = filename(argv[0]);
+    argv++; argc--; // consume the first arg (program name)
+
+    // parse any options, these come before the positional args
+    while((argc) && ('-' == argv[0][0])) {
+        if((0 == strcmp(argv[0], "-s")) && (argc > 1)) {
+            if(0 > (scale = scale_parse(argv[1]))) {
+                fprintf(con, "ERROR: Unknown scaling mode '%s'\n", argv[1]);
+                return -1;
+            }
+            argv += 2; argc -= 2; // consume the option and its value
+        } else if((0 == strcmp(argv[0], "-T")) && (argc > 1)) {
+            tar_name = argv[1];
+            argv += 2; argc -= 2; // consume the option and its value
+        } else if((0 == strcmp(argv[0], "-m")) && (argc > 1)) {
+            man_name = argv[1];
+            argv += 2; argc -= 2; // consume the option and its value
+        } else if(0 == strcmp(argv[0], "-p")) {
+            tar_pal = true;
+            argv++; argc--; // consume the option
+        } else if(0 == strcmp(argv[0], "-V")) {
+            man_verify = true;
+            argv++; argc--; // consume the option
+        } else {
+            fprintf(con, "ERROR: Unknown option '%s'\n", argv[0]);
+            argc = 0; // force the usage message
+        }
+    }
+
+    if((argc < 1) || (argc > 3)) {
+        fprintf(con, "USAGE: %s <options> [infile] <extract> <outfile>\n", prog);
+        fprintf(con, "[infile] is the name of the input MPS file to extract from\n");
+        fprintf(con, "<extract> is the optional numerical index of the image to extract\n");
+        fprintf(con, "if <extract> is omitted, a listing of assets will be printed.\n");
+        fprintf(con, "A value of 0 for <extract> will call all image to be extracted.\n");
+        fprintf(con, "<outfile> optinal name for the output file, ignored if <extract> is 0\n");
+        fprintf(con, "<options>\n");
+        fprintf(con, "  -s [mode]  scale the extracted images, [mode] is one of\n");
+        fprintf(con, "             2x, 3x, 4x  integer nearest neighbour upscaling\n");
+        fprintf(con, "             240, 480    aspect correction to 320x240 or 640x480\n");
+        fprintf(con, "  -T [file]  write the images to a single tar file instead, '-' for stdout\n");
+        fprintf(con, "             all images are written if <extract> is omitted\n");
+        fprintf(con, "  -p         also write the palettes to the tar file as %s files\n", PALEXT);
+        fprintf(con, "  -m [file]  extract incrementally, only images that are missing or out of date\n");
+        fprintf(con, "             are written, and are recorded in the manifest [file], use with <extract> 0\n");
+        fprintf(con, "  -V         with -m, also check the contents of recorded images, not just their size and time\n");
         return -1;
     }
-    argv++; argc--; // consume the first arg (program name)
 
     // get the file names from the command line
     int namelen = strlen(argv[0]);
     if(NULL == (fi_name = calloc(1, namelen+1))) {
-        printf("Unable to allocate memory\n");
+        fprintf(con, "Unable to allocate memory\n");
         goto CLEANUP;
     }
     strncpy(fi_name, argv[0], namelen);
@@ -58,14 +175,21 @@ int main(int argc, char *argv[]) {
     // get the index of the image to extract, if given
     if(argc) {
         sscanf(argv[0],"%u",&xtridx);
+    } else if(tar_name) {
+        xtridx = 0; // extract all images to the tar file
     }
     argv++; argc--; // consume the arg (extract index)
 
+    if((man_name) && ((0 != xtridx) || (tar_name))) {
+        fprintf(con, "ERROR: A manifest can only be used when extracting all images to BMP files\n");
+        goto CLEANUP;
+    }
+
     // get the optional output filename, if extracting a single image
     if((argc) && (xtridx > 0)) {
         namelen = strlen(argv[0]);
         if(NULL == (fo_name = calloc(1, namelen+1))) {
-            printf("Unable to allocate memory\n");
+            fprintf(con, "Unable to allocate memory\n");
             goto CLEANUP;
         }
         strncpy(fo_name, argv[0], namelen);
@@ -73,32 +197,32 @@ int main(int argc, char *argv[]) {
     argv++; argc--; // consume the arg (output file)
 
     // open the input file
-    printf("Opening MPS File: '%s'", fi_name);
+    fprintf(con, "Opening MPS File: '%s'", fi_name);
     if(NULL == (fi = fopen(fi_name,"rb"))) {
-        printf("Error: Unable to open input file\n");
+        fprintf(con, "Error: Unable to open input file\n");
         goto CLEANUP;
     }
 
     // determine size of the EXE file
     size_t fsz = filesize(fi);
-    printf("\tFile Size: %zu\n", fsz);
+    fprintf(con, "\tFile Size: %zu\n", fsz);
 
     // read in the mpsshow information block
     int num_slides = -1;
     if(NULL == (slide_info = read_mps_show_info_header(fi, &num_slides))) {
-        printf("Error reading MPSShow info block\n");
+        fprintf(con, "Error reading MPSShow info block\n");
         goto CLEANUP;
     }
-    printf("Number of slides: %d\n", num_slides);
+    fprintf(con, "Number of slides: %d\n", num_slides);
     // unset extract index if out of range
     if(xtridx > num_slides) {
-        printf("Extract index '%d' out of range\n", xtridx);
+        fprintf(con, "Extract index '%d' out of range\n", xtridx);
         xtridx = -1;
     }
 
     if(-1 == xtridx) { // extract index not set, list all slides
         for(int i = 0; i < num_slides; i++) {
-            printf("%2d: %9.*s - %-25.*s ofs:%06x len:%-6d mode:%02xh [%08x]\n", i+1, 
+            fprintf(con, "%2d: %9.*s - %-25.*s ofs:%06x len:%-6d mode:%02xh [%08x]\n", i+1, 
                 slide_info[i].name_len, slide_info[i].name, 
                 slide_info[i].desc_len, slide_info[i].desc, 
                 slide_info[i].img_offset, slide_info[i].img_len, 
@@ -110,44 +234,166 @@ int main(int argc, char *argv[]) {
 
     // allocate image buffer
     if(NULL == (img.data = calloc(IMAGE_HEIGHT, IMAGE_WIDTH))) {
-        printf("Unable to allocate memory\n");
+        fprintf(con, "Unable to allocate memory\n");
         goto CLEANUP;
     }
     img.len = (IMAGE_HEIGHT * IMAGE_WIDTH);
 
+    // allocate the scaled output buffer, if scaling
+    uint16_t out_width = IMAGE_WIDTH;
+    uint16_t out_height = IMAGE_HEIGHT;
+    memstream_buf_t *out = &img;
+    if(SCALE_NONE != scale) {
+        scale_dims(scale, IMAGE_WIDTH, IMAGE_HEIGHT, &out_width, &out_height);
+        if(NULL == (scaled.data = calloc(out_height, out_width))) {
+            fprintf(con, "Unable to allocate memory\n");
+            goto CLEANUP;
+        }
+        scaled.len = (size_t)out_height * out_width;
+        out = &scaled;
+    }
+
+    // the tar output and the manifest both need the BMPs encoded in memory
+    if((tar_name) || (man_name)) {
+        if(NULL == (bmp.data = malloc(bmp_size(out_width, out_height)))) {
+            fprintf(con, "Unable to allocate memory\n");
+            goto CLEANUP;
+        }
+        bmp.len = bmp_size(out_width, out_height);
+    }
+
+    // open the tar output, all the images are written to it as one sequential stream
+    if(tar_name) {
+        fo = (0 == strcmp(tar_name, "-")) ? stdout : fopen(tar_name, "wb");
+        if(NULL == fo) {
+            fprintf(con, "Error: Unable to open output file\n");
+            goto CLEANUP;
+        }
+        setvbuf(fo, NULL, _IOFBF, TARBUFSZ);
+        tar_header_init(&th, time(NULL));
+        fprintf(con, "Writing to: '%s'\n", tar_name);
+    }
 
     if(0 == xtridx) { // extract all images
 
         // create the output filename buffer
         free_s(fo_name); // if prefiously allocated, free it
         if(NULL == (fo_name = calloc(1, 16))) {
-            printf("Unable to allocate memory\n");
+            fprintf(con, "Unable to allocate memory\n");
+            goto CLEANUP;
+        }
+
+        // with a manifest, only the images that are missing or out of date are extracted
+        if(man_name) {
+            if(0 != manifest_open(&man, man_name)) {
+                fprintf(con, "Error: Unable to open manifest '%s'\n", man_name);
+                goto CLEANUP;
+            }
+            man_open = true;
+
+            // the input is unchanged if it has the same size and time, or the same contents
+            manifest_entry_t in = {fi_name, 0, 0, 0};
+            if(0 != manifest_stat(&in)) {
+                fprintf(con, "Error: Unable to read input file\n");
+                goto CLEANUP;
+            }
+            const manifest_input_t *prev = manifest_input(&man, fi_name);
+            bool same = (prev) && (prev->input.size == in.size);
+            if((same) && (prev->input.mtime == in.mtime)) {
+                in.crc = prev->input.crc;
+            } else {
+                if(0 != manifest_hash(fi_name, &in.crc)) {
+                    fprintf(con, "Error: Unable to read input file\n");
+                    goto CLEANUP;
+                }
+                same = (same) && (prev->input.crc == in.crc);
+            }
+            if(0 != manifest_set_input(&man, &in, same)) {
+                fprintf(con, "Error: Unable to write manifest '%s'\n", man_name);
+                goto CLEANUP;
+            }
+
+            if(NULL == (want = calloc(num_slides, 1))) {
+                fprintf(con, "Unable to allocate memory\n");
+                goto CLEANUP;
+            }
+            char name[32];
+            for(int i = 0; i < num_slides; i++) {
+                snprintf(name, sizeof(name), "%.*s%s", slide_info[i].name_len, slide_info[i].name, OUTEXT);
+                const manifest_entry_t *rec = manifest_find(&man, name);
+                want[i] = !((rec) && (rec->size == bmp.len) && (manifest_current(&man, name, man_verify)));
+            }
+        }
+
+        // read the image data of all the slides in a few large sequential reads, any
+        // slides in a read that fails are read on their own below
+        if(NULL == (plan = mps_plan_create(slide_info, num_slides, want, MPS_PLAN_GAP))) {
+            fprintf(con, "Unable to allocate memory\n");
             goto CLEANUP;
         }
+        int num_failed = mps_plan_load(plan, fi);
+        if(num_failed) {
+            fprintf(con, "Warning: %d of %d reads failed, reading those images one at a time\n", num_failed, plan->num_ranges);
+        }
 
         for(int i = 0; i < num_slides; i++) {
             // create the output filename based on the name in the slide
             sprintf(fo_name, "%.*s%s", slide_info[i].name_len, slide_info[i].name, OUTEXT);
-            printf("Saving: '%s'\n", fo_name);
+            if((want) && (!want[i])) {
+                fprintf(con, "Up to date: '%s'\n", fo_name);
+                continue;
+            }
+            fprintf(con, "Saving: '%s'\n", fo_name);
 
             // reset the image buffer
             img.pos = 0;
             memset(img.data,0,img.len);
 
-            // read in the image
-            if(0 != read_mps_show_image(&img, fi, &slide_info[i])) {
-                printf("Error: Unable to read image\n");
+            // decode the image, a slide that cannot be read is reported and skipped
+            if(0 != mps_plan_image(plan, i, &img)) {
+                img.pos = 0;
+                memset(img.data,0,img.len);
+                if(0 != read_mps_show_image(&img, fi, &slide_info[i])) {
+                    fprintf(con, "Error: Unable to read image %d '%s', skipped\n", i + 1, fo_name);
+                    num_bad++;
+                    continue;
+                }
+            }
+
+            // upscale for output, if requested
+            if((SCALE_NONE != scale) && (0 != scale_image(&scaled, &img, IMAGE_WIDTH, IMAGE_HEIGHT, scale))) {
+                fprintf(con, "Error: Unable to scale image\n");
                 goto CLEANUP;
             }
 
+            if(fo) { // add it to the tar stream
+                if(0 != tar_slide(fo, &th, &bmp, out, out_width, out_height, &slide_info[i], tar_pal)) {
+                    fprintf(con, "Error: Unable to write to tar file\n");
+                    goto CLEANUP;
+                }
+                continue;
+            }
+
             // convert it for BMP output
             // convert from 6-bit/component (VGA) to 8-bit/component (BMP)
             pal6_to_pal8(slide_info[i].pal, slide_info[i].pal, 256);
-            if(0 != save_bmp(fo_name, &img, IMAGE_WIDTH, IMAGE_HEIGHT, slide_info[i].pal)) {
-                printf("Error: Unable to save BMP image\n");
+            if(man_open) { // encoded in memory, so its CRC can be recorded
+                bmp.pos = 0;
+                if((0 != encode_bmp(&bmp, out, out_width, out_height, slide_info[i].pal)) ||
+                   (0 != save_recorded(&man, fo_name, &bmp))) {
+                    fprintf(con, "Error: Unable to save BMP image\n");
+                    goto CLEANUP;
+                }
+                continue;
+            }
+            if(0 != save_bmp(fo_name, out, out_width, out_height, slide_info[i].pal)) {
+                fprintf(con, "Error: Unable to save BMP image\n");
                 goto CLEANUP;
             }
         }
+        if(num_bad) {
+            fprintf(con, "Error: %d of %d images could not be read\n", num_bad, num_slides);
+        }
         goto DONE;
     }
 
@@ -156,35 +402,62 @@ int main(int argc, char *argv[]) {
     // create the output filename if not set
     if(NULL == fo_name) {
         if(NULL == (fo_name = calloc(1, 16))) {
-            printf("Unable to allocate memory\n");
+            fprintf(con, "Unable to allocate memory\n");
             goto CLEANUP;
         }
         sprintf(fo_name, "%.*s%s", slide_info[xtridx].name_len, slide_info[xtridx].name, OUTEXT);
     }
-    printf("Saving: '%s'\n", fo_name);
+    fprintf(con, "Saving: '%s'\n", fo_name);
 
     // read in the image
     if(0 != read_mps_show_image(&img, fi, &slide_info[xtridx])) {
-        printf("Error: Unable to read image\n");
+        fprintf(con, "Error: Unable to read image\n");
         goto CLEANUP;
     }
 
+    // upscale for output, if requested
+    if((SCALE_NONE != scale) && (0 != scale_image(&scaled, &img, IMAGE_WIDTH, IMAGE_HEIGHT, scale))) {
+        fprintf(con, "Error: Unable to scale image\n");
+        goto CLEANUP;
+    }
+
+    if(fo) { // add it to the tar stream
+        if(0 != tar_slide(fo, &th, &bmp, out, out_width, out_height, &slide_info[xtridx], tar_pal)) {
+            fprintf(con, "Error: Unable to write to tar file\n");
+            goto CLEANUP;
+        }
+        goto DONE;
+    }
+
     // convert it for BMP output
     // convert from 6-bit/component (VGA) to 8-bit/component (BMP)
     pal6_to_pal8(slide_info[xtridx].pal, slide_info[xtridx].pal, 256);
-    if(0 != save_bmp(fo_name, &img, IMAGE_WIDTH, IMAGE_HEIGHT, slide_info[xtridx].pal)) {
-        printf("Error: Unable to save BMP image\n");
+    if(0 != save_bmp(fo_name, out, out_width, out_height, slide_info[xtridx].pal)) {
+        fprintf(con, "Error: Unable to save BMP image\n");
         goto CLEANUP;
     }
 
 DONE:
-    rval = 0; // clean exit
+    // finish off the tar stream
+    if((fo) && ((0 != tar_write_end(fo)) || (0 != fflush(fo)))) {
+        fprintf(con, "Error: Unable to write to tar file\n");
+        goto CLEANUP;
+    }
+    rval = (num_bad) ? 1 : 0; // clean exit, unless some images were skipped
 
 CLEANUP:
     fclose_s(fi);
     fclose_s(fo);
     free_s(img.data);
+    free_s(scaled.data);
+    free_s(bmp.data);
     free_s(slide_info);
+    mps_plan_free(plan);
+    free_s(want);
+    if((man_open) && (0 != manifest_close(&man))) {
+        fprintf(con, "Error: Unable to write manifest '%s'\n", man_name);
+        rval = -1;
+    }
     free_s(fi_name);
     free_s(fo_name);
     return rval;
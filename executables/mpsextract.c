@@ -8,6 +8,10 @@
  * null data is skipped. Once the first non-zero byte is located, the contents from
  * that point to EOF are copied to the output file.
  *
+ * The input may be given as '-' to read the EXE from stdin (e.g. a pipe from a
+ * decompressor), in which case it is read once from start to end without seeking,
+ * and the output may be given as '-' to write the MPS data to stdout.
+ *
  * This code is offered without warranty under the MIT License. Use it as you will 
  * personally or commercially, just give credit if you do.
  */
@@ -32,14 +36,22 @@ int main(int argc, char *argv[]) {
     char *fo_name = NULL;
     uint8_t *buf = NULL;
     info_t *slide_info = NULL;
+    FILE *con = stdout;    // console for messages, stderr if the output goes to stdout
+    bool stream = false;   // input is stdin, read it once from start to end without seeking
+
+    // if the output is going to stdout, keep our messages out of it
+    if((3 == argc) && (0 == strcmp(argv[2], "-"))) {
+        con = stderr;
+    }
 
-    printf("MPSextract - MPSShow Data Extractor\n");
+    fprintf(con, "MPSextract - MPSShow Data Extractor\n");
 
     if((argc < 2) || (argc > 3)) {
-        printf("USAGE: %s [infile] <outfile>\n", filename(argv[0]));
-        printf("[infile] is the name of the input EXE file to extract from\n");
-        printf("<outfile> is optional and the name of the output file\n");
-        printf("if omitted, the output will be named the same as infile, except with a '%s' extension\n", OUTEXT);
+        fprintf(con, "USAGE: %s [infile] <outfile>\n", filename(argv[0]));
+        fprintf(con, "[infile] is the name of the input EXE file to extract from\n");
+        fprintf(con, "<outfile> is optional and the name of the output file\n");
+        fprintf(con, "if omitted, the output will be named the same as infile, except with a '%s' extension\n", OUTEXT);
+        fprintf(con, "use '-' for [infile] to read from stdin, and '-' for <outfile> to write to stdout\n");
         return -1;
     }
     argv++; argc--; // consume the first arg (program name)
@@ -47,7 +59,7 @@ int main(int argc, char *argv[]) {
     // get the file names from the command line
     int namelen = strlen(argv[0]);
     if(NULL == (fi_name = calloc(1, namelen+1))) {
-        printf("Unable to allocate memory\n");
+        fprintf(con, "Unable to allocate memory\n");
         goto CLEANUP;
     }
     strncpy(fi_name, argv[0], namelen);
@@ -56,14 +68,14 @@ int main(int argc, char *argv[]) {
     if(argc) { // output file name was provided
         int namelen = strlen(argv[0]);
         if(NULL == (fo_name = calloc(1, namelen+1))) {
-            printf("Unable to allocate memory\n");
+            fprintf(con, "Unable to allocate memory\n");
             goto CLEANUP;
         }
         strncpy(fo_name, argv[0], namelen);
         argv++; argc--; // consume the arg (input file)
     } else { // no name was provded, so make one
         if(NULL == (fo_name = calloc(1, namelen+5))) {
-            printf("Unable to allocate memory\n");
+            fprintf(con, "Unable to allocate memory\n");
             goto CLEANUP;
         }
         strncpy(fo_name, fi_name, namelen);
@@ -72,48 +84,81 @@ int main(int argc, char *argv[]) {
     }
 
     // open the input file
-    printf("Opening EXE File: '%s'", fi_name);
-    if(NULL == (fi = fopen(fi_name,"rb"))) {
-        printf("Error: Unable to open input file\n");
-        goto CLEANUP;
-    }
+    size_t fsz = 0;
+    if(0 == strcmp(fi_name, "-")) {
+        fprintf(con, "Reading EXE from stdin\n");
+        fi = stdin;
+        stream = true;
+        if((0 == strcmp(fo_name, "-.MPS")) || (0 == strcmp(fo_name, ".MPS"))) {
+            fprintf(con, "Error: an output file name is needed when reading from stdin\n");
+            goto CLEANUP;
+        }
+    } else {
+        fprintf(con, "Opening EXE File: '%s'", fi_name);
+        if(NULL == (fi = fopen(fi_name,"rb"))) {
+            fprintf(con, "Error: Unable to open input file\n");
+            goto CLEANUP;
+        }
 
-    // determine size of the EXE file
-    size_t fsz = filesize(fi);
-    printf("\tFile Size: %zu\n", fsz);
+        // determine size of the EXE file
+        fsz = filesize(fi);
+        fprintf(con, "\tFile Size: %zu\n", fsz);
+    }
 
     dos_exe_hdr_t hdr;
     int nr = fread(&hdr, sizeof(dos_exe_hdr_t), 1, fi);
     if(1 != nr) {
-        printf("Error reading EXE header\n");
+        fprintf(con, "Error reading EXE header\n");
         goto CLEANUP;
     }
 
     // check for the EXE signature
     if(strncmp(EXE_SIG, hdr.signature, sizeof(hdr.signature))) {
-        printf("Invalid EXE header\n");
+        fprintf(con, "Invalid EXE header\n");
         goto CLEANUP;
     }
 
     // do a basic size check
     size_t exe_sz = ((size_t)hdr.num_blocks - 1) * EXE_BLOCK_SZ + hdr.len_final;
-    if(fsz == exe_sz) {
-        printf("EXE does not contain appended data\n");
+    if(exe_sz < sizeof(dos_exe_hdr_t)) {
+        fprintf(con, "Invalid EXE header\n");
+        goto CLEANUP;
+    }
+    if((!stream) && (fsz == exe_sz)) {
+        fprintf(con, "EXE does not contain appended data\n");
         goto CLEANUP;
     }
-    printf("Reported EXE size: %zu bytes\n", exe_sz);
+    fprintf(con, "Reported EXE size: %zu bytes\n", exe_sz);
 
-    // go to end of reported EXE file
-    fseek(fi, exe_sz, SEEK_SET);
+    // allocate our copy buffer
+    if(NULL == (buf = malloc(BUFSZ))) {
+        fprintf(con, "Unable to allocate buffer\n");
+        goto CLEANUP;
+    }
+
+    // go to end of reported EXE file, a stream can't seek so the EXE is read and discarded
+    if(stream) {
+        size_t skip = exe_sz - sizeof(dos_exe_hdr_t);
+        while(skip) {
+            size_t n = (skip < BUFSZ) ? skip : BUFSZ;
+            if(n != fread(buf, 1, n, fi)) {
+                fprintf(con, "Unexpected end of file\n");
+                goto CLEANUP;
+            }
+            skip -= n;
+        }
+    } else {
+        fseek(fi, exe_sz, SEEK_SET);
+    }
 
     // now we can scan for the beginning of non-null data, 
     // which should be our MPSShow data
     if(feof(fi)) {
-        printf("Unexpected end of file\n");
+        fprintf(con, "Unexpected end of file\n");
         goto CLEANUP;
     }
 
-    printf("Scanning for start of data...");
+    fprintf(con, "Scanning for start of data...");
     int rec_count = 0;
 
     uint32_t count = 0;
@@ -122,42 +167,47 @@ int main(int argc, char *argv[]) {
         count++;
         // print a "heartbeat" every 1K bytes
         if((count&0x03ff) == 0) {
-            printf(".");
-            fflush(stdout);
+            fprintf(con, ".");
+            fflush(con);
         }
     }
-    printf(".done\n");
+    fprintf(con, ".done\n");
     if(rec_count==EOF) {
-        printf("Reached end of file with no data\n");
+        fprintf(con, "Reached end of file with no data\n");
         goto CLEANUP;
     }
 
-    size_t mps_pos = ftell(fi) - 1;
-    printf("Start of data at: 0x%06zx\n", mps_pos);
-    fseek(fi, mps_pos, SEEK_SET); // rewind one byte
+    size_t mps_pos = exe_sz + count - 1;
+    fprintf(con, "Start of data at: 0x%06zx\n", mps_pos);
+    ungetc(rec_count, fi); // push back the slide count for reading the info block
 
     // do a quick sanity check to make sure we have at least enough room
-    // for all the reported records.
+    // for all the reported records, the size of a stream is not known
     size_t mps_sz = fsz - mps_pos;
     size_t mps_info_sz = MPSRECSZ * rec_count;
-    if(mps_sz <= mps_info_sz) { // not enough left in the file to be valid
-        printf("Remaining data too short to be MPSShow data\n");
+    if((!stream) && (mps_sz <= mps_info_sz)) { // not enough left in the file to be valid
+        fprintf(con, "Remaining data too short to be MPSShow data\n");
         goto CLEANUP;
     }
 
-    printf("Extracting data to: '%s'\tData Size: %zu\n", fo_name, mps_sz);
+    if(stream) {
+        fprintf(con, "Extracting data to: '%s'\n", fo_name);
+    } else {
+        fprintf(con, "Extracting data to: '%s'\tData Size: %zu\n", fo_name, mps_sz);
+    }
     // open the output file
-    if(NULL == (fo = fopen(fo_name,"wb"))) {
-        printf("Error: Unable to open output file\n");
+    fo = (0 == strcmp(fo_name, "-")) ? stdout : fopen(fo_name,"wb");
+    if(NULL == fo) {
+        fprintf(con, "Error: Unable to open output file\n");
         goto CLEANUP;
     }
 
     int num_slides = -1;
     if(NULL == (slide_info = read_mps_show_info_header(fi, &num_slides))) {
-        printf("Error reading MPSShow info block\n");
+        fprintf(con, "Error reading MPSShow info block\n");
         goto CLEANUP;
     }
-    printf("Number of slides: %d\n", num_slides);
+    fprintf(con, "Number of slides: %d\n", num_slides);
 
     // correct the slide offsets from being EXE centric
     // to being relative to the new MPS file
@@ -169,27 +219,22 @@ int main(int argc, char *argv[]) {
     fputc(num_slides, fo);
     int nw = fwrite(slide_info, sizeof(info_t), num_slides, fo);
     if(num_slides != nw) {
-        printf("Error writing output\n");
+        fprintf(con, "Error writing output\n");
         goto CLEANUP;
     }
 
     // copy the remaining data, print a heartbeat once every BUFSZ block
-    // allocate our copy buffer
-    if(NULL == (buf = malloc(BUFSZ))) {
-        printf("Unable to allocate buffer\n");
-        goto CLEANUP;
-    }
-    printf("Copying.");
+    fprintf(con, "Copying.");
     do {
         nr = fread(buf, 1, BUFSZ, fi);
-        printf(".");
+        fprintf(con, ".");
         int nw = fwrite(buf, nr, 1, fo);
-        if(1 != nw) {
-            printf("Error writing output\n");
+        if((nr) && (1 != nw)) {
+            fprintf(con, "Error writing output\n");
             goto CLEANUP;
         }
     } while(BUFSZ == nr);
-    printf(".done\n");
+    fprintf(con, ".done\n");
 
     rval = 0; // clean exit
 
@@ -197,6 +242,7 @@ CLEANUP:
     fclose_s(fi);
     fclose_s(fo);
     free_s(buf);
+    free_s(slide_info);
     free_s(fi_name);
     free_s(fo_name);
     return rval;
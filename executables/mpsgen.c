@@ -0,0 +1,306 @@
+/*
+ * MPSgen.c
+ * Generates synthetic MPSShow slideshow demo files for testing and benchmarking. The
+ * output is laid out the same as a MicroProse demo EXE, a valid MS-DOS EXE header and
+ * image, a block of null padding, then the MPSShow data, so it can be used as input to
+ * 'MPSextract', or the MPSShow data can be written on its own for the other tools.
+ *
+ * The number of slides, the frame content, and the distribution of the RLE run lengths
+ * can all be chosen, along with a seed, so the same file can be generated again.
+ *
+ * This code is offered without warranty under the MIT License. Use it as you will
+ * personally or commercially, just give credit if you do.
+ */
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "util.h"
+#include "mps-show.h"
+#include "dos-exe.h"
+
+#define IMAGE_WIDTH (320)
+#define IMAGE_HEIGHT (200)
+#define IMAGE_SIZE (IMAGE_WIDTH * IMAGE_HEIGHT)
+#define MAX_RLE_SIZE (IMAGE_SIZE * 2) // largest an image's RLE data can be, runs of 1
+#define DEF_SLIDES (16)
+#define DEF_EXE_SIZE (8000)
+#define DEF_PADDING (4096)
+
+// distributions of the run lengths
+typedef enum {
+    RUNS_MIXED = 0,     // half short runs, half long runs
+    RUNS_SHORT,         // 1 to 8 pixels
+    RUNS_LONG,          // 64 to 255 pixels
+    RUNS_MAX,           // always 255 pixels, the best case for the decoder
+    RUNS_WORST,         // always 2 pixels, the most records a slide's 16 bit length allows
+} runs_t;
+
+// frame content, the colour of each run
+typedef enum {
+    CONTENT_NOISE = 0,  // random colours
+    CONTENT_BANDS,      // colour follows the line, giving horizontal bands
+    CONTENT_SOLID,      // a single colour per slide
+} content_t;
+
+static const char *runs_names[] = {"mixed", "short", "long", "max", "worst", NULL};
+static const char *content_names[] = {"noise", "bands", "solid", NULL};
+
+/// @brief small, fast, and the same on every platform, so a seed always gives the same file
+static uint32_t rng_next(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return (uint32_t)(*state >> 32);
+}
+
+static int rng_range(uint64_t *state, int lo, int hi) {
+    return lo + (int)(rng_next(state) % (uint32_t)(hi - lo + 1));
+}
+
+/// @brief finds a name in a list of names
+/// @return the index of the name, -1 if not found
+static int parse_name(const char *name, const char **names) {
+    for(int i = 0; names[i]; i++) {
+        if(0 == strcmp(name, names[i])) return i;
+    }
+    return -1;
+}
+
+/// @brief generates the RLE data for one slide
+/// @param dst buffer of at least MAX_RLE_SIZE bytes
+/// @return length of the RLE data
+static size_t gen_image(uint8_t *dst, uint64_t *rng, runs_t runs, content_t content) {
+    size_t len = 0;
+    int px = 0;
+    uint8_t solid = (uint8_t)rng_next(rng);
+
+    while(px < IMAGE_SIZE) {
+        int count;
+        switch(runs) {
+            case RUNS_SHORT:    count = rng_range(rng, 1, 8); break;
+            case RUNS_LONG:     count = rng_range(rng, 64, 255); break;
+            case RUNS_MAX:      count = 255; break;
+            case RUNS_WORST:    count = 2; break;
+            default:            count = (rng_next(rng) & 1) ? rng_range(rng, 1, 8) : rng_range(rng, 9, 255); break;
+        }
+        if(count > (IMAGE_SIZE - px)) {
+            count = IMAGE_SIZE - px;
+        }
+        uint8_t pix;
+        switch(content) {
+            case CONTENT_BANDS: pix = (uint8_t)(px / IMAGE_WIDTH); break;
+            case CONTENT_SOLID: pix = solid; break;
+            default:            pix = (uint8_t)rng_next(rng); break;
+        }
+        dst[len++] = (uint8_t)count;
+        dst[len++] = pix;
+        px += count;
+    }
+    return len;
+}
+
+int main(int argc, char *argv[]) {
+    int rval = -1;
+    FILE *fo = NULL;
+    int num_slides = DEF_SLIDES;
+    size_t exe_sz = DEF_EXE_SIZE;
+    size_t padding = DEF_PADDING;
+    uint64_t seed = 1;
+    runs_t runs = RUNS_MIXED;
+    content_t content = CONTENT_NOISE;
+    bool bare = false;
+    info_t *slide_info = NULL;
+    uint8_t **images = NULL;
+    uint8_t *buf = NULL;
+
+    printf("MPSgen - MPSShow Test Data Generator\n");
+
+    char *prog = filename(argv[0]);
+    argv++; argc--; // consume the first arg (program name)
+
+    // parse any options, these come before the positional args
+    while((argc) && ('-' == argv[0][0])) {
+        if((0 == strcmp(argv[0], "-n")) && (argc > 1)) {
+            num_slides = atoi(argv[1]);
+            argv += 2; argc -= 2; // consume the option and its value
+        } else if((0 == strcmp(argv[0], "-r")) && (argc > 1)) {
+            if(0 > (int)(runs = parse_name(argv[1], runs_names))) {
+                printf("ERROR: Unknown run length distribution '%s'\n", argv[1]);
+                return -1;
+            }
+            argv += 2; argc -= 2; // consume the option and its value
+        } else if((0 == strcmp(argv[0], "-c")) && (argc > 1)) {
+            if(0 > (int)(content = parse_name(argv[1], content_names))) {
+                printf("ERROR: Unknown frame content '%s'\n", argv[1]);
+                return -1;
+            }
+            argv += 2; argc -= 2; // consume the option and its value
+        } else if((0 == strcmp(argv[0], "-e")) && (argc > 1)) {
+            exe_sz = strtoul(argv[1], NULL, 0);
+            argv += 2; argc -= 2; // consume the option and its value
+        } else if((0 == strcmp(argv[0], "-p")) && (argc > 1)) {
+            padding = strtoul(argv[1], NULL, 0);
+            argv += 2; argc -= 2; // consume the option and its value
+        } else if((0 == strcmp(argv[0], "-s")) && (argc > 1)) {
+            seed = strtoull(argv[1], NULL, 0);
+            argv += 2; argc -= 2; // consume the option and its value
+        } else if(0 == strcmp(argv[0], "-m")) {
+            bare = true;
+            argv++; argc--; // consume the option
+        } else {
+            printf("ERROR: Unknown option '%s'\n", argv[0]);
+            argc = 0; // force the usage message
+        }
+    }
+
+    if((1 != argc) || (num_slides < 1) || (num_slides > 255) || (exe_sz < sizeof(dos_exe_hdr_t)) || (exe_sz > (1 << 24))) {
+        printf("USAGE: %s <options> [outfile]\n", prog);
+        printf("[outfile] is the name of the demo EXE file to generate\n");
+        printf("<options>\n");
+        printf("  -n [count]    number of slides (1-255, default %d)\n", DEF_SLIDES);
+        printf("  -r [runs]     run lengths, one of 'mixed' (default), 'short' (1-8), 'long' (64-255),\n");
+        printf("                'max' (all 255), or 'worst' (all 2)\n");
+        printf("  -c [content]  frame content, one of 'noise' (default), 'bands', or 'solid'\n");
+        printf("  -e [bytes]    size of the EXE image (default %d)\n", DEF_EXE_SIZE);
+        printf("  -p [bytes]    null padding between the EXE image and the MPSShow data (default %d)\n", DEF_PADDING);
+        printf("  -s [seed]     seed for the random content (default 1)\n");
+        printf("  -m            write only the MPSShow data, as a .MPS file\n");
+        return -1;
+    }
+    if(0 == seed) seed = 1; // xorshift never leaves 0
+    uint64_t rng = seed * 0x9e3779b97f4a7c15ull;
+    if(bare) {
+        exe_sz = 0;
+        padding = 0;
+    }
+
+    // the extractor locates the appended data from the final block size, which must not be 0
+    if((exe_sz) && (0 == (exe_sz % EXE_BLOCK_SZ))) {
+        exe_sz++;
+    }
+
+    // generate all the images first, their sizes are needed for the info block
+    if((NULL == (slide_info = calloc(num_slides, sizeof(info_t)))) ||
+       (NULL == (images = calloc(num_slides, sizeof(uint8_t *)))) ||
+       (NULL == (buf = malloc(MAX_RLE_SIZE)))) {
+        printf("Unable to allocate memory\n");
+        goto CLEANUP;
+    }
+    size_t mps_pos = exe_sz + padding;
+    size_t ofs = mps_pos + 1 + (size_t)num_slides * MPSRECSZ;
+    size_t total = 0;
+    for(int i = 0; i < num_slides; i++) {
+        info_t *si = &slide_info[i];
+        size_t len = gen_image(buf, &rng, runs, content);
+        if(len > UINT16_MAX) { // can't happen with the distributions above
+            printf("Error: Slide %d is too large\n", i + 1);
+            goto CLEANUP;
+        }
+        if(NULL == (images[i] = malloc(len))) {
+            printf("Unable to allocate memory\n");
+            goto CLEANUP;
+        }
+        memcpy(images[i], buf, len);
+
+        char name[16], desc[32];
+        snprintf(name, sizeof(name), "GEN%03d", i);
+        snprintf(desc, sizeof(desc), "Generated slide %d", i);
+        si->name_len = (uint8_t)strlen(name);
+        memcpy(si->name, name, si->name_len);
+        si->desc_len = (uint8_t)strlen(desc);
+        memcpy(si->desc, desc, si->desc_len);
+        si->img_offset = (uint32_t)ofs;
+        si->mode = 0x13;
+        si->img_len = (uint16_t)len;
+        for(int c = 0; c < 256; c++) {
+            if(CONTENT_NOISE == content) {
+                si->pal[c].r = rng_next(&rng) & 0x3f;
+                si->pal[c].g = rng_next(&rng) & 0x3f;
+                si->pal[c].b = rng_next(&rng) & 0x3f;
+            } else { // a grey ramp
+                si->pal[c].r = si->pal[c].g = si->pal[c].b = (uint8_t)(c >> 2);
+            }
+        }
+        ofs += len;
+        total += len;
+    }
+
+    if(NULL == (fo = fopen(argv[0], "wb"))) {
+        printf("Error: Unable to create '%s'\n", argv[0]);
+        goto CLEANUP;
+    }
+
+    // the EXE image, a header followed by some code-like non null bytes
+    if(exe_sz) {
+        dos_exe_hdr_t hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        memcpy(hdr.signature, EXE_SIG, sizeof(hdr.signature));
+        hdr.len_final = (uint16_t)(exe_sz % EXE_BLOCK_SZ);
+        hdr.num_blocks = (uint16_t)((exe_sz / EXE_BLOCK_SZ) + 1);
+        hdr.pg_header = 2;
+        hdr.pg_mem_max = 0xffff;
+        hdr.reg_ip = 0x100;
+        hdr.off_reloc = sizeof(hdr);
+        memset(buf, 0, 32);
+        memcpy(buf, &hdr, sizeof(hdr));
+
+        // written a buffer at a time, the header being at the start of the first
+        size_t first = 32;
+        for(size_t left = exe_sz; left; ) {
+            size_t n = (left < MAX_RLE_SIZE) ? left : MAX_RLE_SIZE;
+            for(size_t i = first; i < n; i++) {
+                buf[i] = (uint8_t)(1 + rng_next(&rng) % 255);
+            }
+            if(1 != fwrite(buf, n, 1, fo)) goto write_error;
+            left -= n;
+            first = 0;
+        }
+
+        memset(buf, 0, MAX_RLE_SIZE);
+        for(size_t left = padding; left; ) {
+            size_t n = (left < MAX_RLE_SIZE) ? left : MAX_RLE_SIZE;
+            if(1 != fwrite(buf, n, 1, fo)) goto write_error;
+            left -= n;
+        }
+    }
+
+    // the MPSShow data, the offsets in the info block are from the start of the file
+    uint8_t count = (uint8_t)num_slides;
+    if((1 != fwrite(&count, 1, 1, fo)) ||
+       (num_slides != (int)fwrite(slide_info, sizeof(info_t), num_slides, fo))) {
+        goto write_error;
+    }
+    for(int i = 0; i < num_slides; i++) {
+        if(1 != fwrite(images[i], slide_info[i].img_len, 1, fo)) goto write_error;
+    }
+    if(0 != fclose(fo)) {
+        fo = NULL;
+        goto write_error;
+    }
+    fo = NULL;
+
+    printf("Generated '%s'\tSlides: %d\tImage data: %zu bytes\tFile Size: %zu\n", argv[0], num_slides, total, ofs);
+    if(exe_sz) {
+        printf("EXE size: %zu bytes\tMPSShow data at: 0x%06zx\n", exe_sz, mps_pos);
+    }
+    rval = 0; // clean exit
+    goto CLEANUP;
+
+write_error:
+    printf("Error: Unable to write to '%s'\n", argv[0]);
+
+CLEANUP:
+    fclose_s(fo);
+    if(images) {
+        for(int i = 0; i < num_slides; i++) {
+            free_s(images[i]);
+        }
+    }
+    free_s(images);
+    free_s(slide_info);
+    free_s(buf);
+    return rval;
+}
@@ -0,0 +1,355 @@
+/*
+ * MPSgif.c
+ * Exports a whole MPSShow slideshow (.MPS) as a single animated GIF image, for previews.
+ *
+ * Each frame carries its own palette as a local colour table, so the slides keep their
+ * exact colours. Only the rectangle of the image that differs from the previous slide, as
+ * it appears on screen, is written for each frame. The slides are decoded on a second
+ * thread, so the next slide is being decoded while the current one is being compressed.
+ *
+ * To obtain the .MPS file you can use 'MPSextract' on a MPSShow slideshow demo exe file
+ *
+ * This code is offered without warranty under the MIT License. Use it as you will
+ * personally or commercially, just give credit if you do.
+ */
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "util.h"
+#include "mps-show.h"
+#include "mps-rgb.h"
+#include "gif.h"
+
+#define OUTEXT    ".GIF"    // default extension for the output file
+#define DEF_DELAY (300)     // time to show each slide, in 1/100ths of a second
+#define NUM_SLOTS (3)       // the previous frame, the one being encoded, and the next one
+#define OUTBUFSZ  (1 << 20) // output stream buffer size
+
+#define FRAME_PIXELS (MPS_WIDTH * MPS_HEIGHT)
+
+// one decoded slide
+typedef struct {
+    uint8_t     *idx;       // the indexed image, as stored
+    uint32_t    lut[256];   // the palette as RGBA colours, for finding what changed
+    int         err;        // non zero if the slide could not be decoded
+} frame_t;
+
+// the frames being passed from the decoding thread to the encoder
+typedef struct {
+    int             fd;
+    info_t          *slide_info;
+    int             num_slides;
+    frame_t         frame[NUM_SLOTS];   // frame 'i' is decoded into slot 'i % NUM_SLOTS'
+    int             decoded;            // number of frames decoded
+    int             released;           // number of frames whose slot may be reused
+    bool            stop;               // the encoder has given up
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+} pipeline_t;
+
+/// @brief decodes one slide into a frame, a short image is padded with colour 0
+/// @return 0 on success
+static int decode_frame(frame_t *f, int fd, info_t *slide) {
+    memstream_buf_t idx = {FRAME_PIXELS, 0, f->idx};
+
+    if(0 != read_mps_show_image_fd(&idx, fd, slide)) {
+        return -1;
+    }
+    if(idx.pos < FRAME_PIXELS) {
+        memset(&f->idx[idx.pos], 0, FRAME_PIXELS - idx.pos);
+    }
+    mps_rgb_lut32(f->lut, slide->pal);
+    return 0;
+}
+
+/// @brief the decoding thread, runs ahead of the encoder by as many frames as there are free slots
+static void *decoder(void *arg) {
+    pipeline_t *p = arg;
+    for(int i = 0; i < p->num_slides; i++) {
+        pthread_mutex_lock(&p->lock);
+        while((!p->stop) && ((i - p->released) >= NUM_SLOTS)) {
+            pthread_cond_wait(&p->cond, &p->lock);
+        }
+        bool stop = p->stop;
+        pthread_mutex_unlock(&p->lock);
+        if(stop) {
+            break;
+        }
+
+        frame_t *f = &p->frame[i % NUM_SLOTS];
+        f->err = decode_frame(f, p->fd, &p->slide_info[i]);
+
+        pthread_mutex_lock(&p->lock);
+        p->decoded = i + 1;
+        pthread_cond_broadcast(&p->cond);
+        pthread_mutex_unlock(&p->lock);
+        if(f->err) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/// @brief checks if a row of pixels looks different on screen between two frames
+static bool row_differs(const frame_t *a, const frame_t *b, bool same_pal, int y) {
+    const uint8_t *ra = &a->idx[y * MPS_WIDTH];
+    const uint8_t *rb = &b->idx[y * MPS_WIDTH];
+    if(same_pal && (0 == memcmp(ra, rb, MPS_WIDTH))) {
+        return false;
+    }
+    // two indexes can still be the same colour
+    for(int x = 0; x < MPS_WIDTH; x++) {
+        if(a->lut[ra[x]] != b->lut[rb[x]]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// @brief finds the smallest rectangle that holds every pixel whose colour differs between
+/// two frames, the colours are compared through each frame's palette
+/// @param a the previous frame
+/// @param b the new frame
+/// @param rect the rectangle found as x, y, width, height
+/// @return true if the frames differ
+static bool diff_rect(const frame_t *a, const frame_t *b, int *rect) {
+    // with the same palette, rows with the same indexes can be skipped quickly
+    bool same_pal = (0 == memcmp(a->lut, b->lut, sizeof(a->lut)));
+    int top = 0, bottom = MPS_HEIGHT - 1;
+
+    // whole rows are compared first
+    while((top < MPS_HEIGHT) && !row_differs(a, b, same_pal, top)) {
+        top++;
+    }
+    if(top == MPS_HEIGHT) {
+        return false;
+    }
+    while(!row_differs(a, b, same_pal, bottom)) {
+        bottom--;
+    }
+
+    // then the columns, each row only needs checking outside the edges found so far
+    int left = MPS_WIDTH, right = -1;
+    for(int y = top; y <= bottom; y++) {
+        const uint8_t *ra = &a->idx[y * MPS_WIDTH];
+        const uint8_t *rb = &b->idx[y * MPS_WIDTH];
+        for(int x = 0; x < left; x++) {
+            if(a->lut[ra[x]] != b->lut[rb[x]]) {
+                left = x;
+                break;
+            }
+        }
+        for(int x = MPS_WIDTH - 1; x > right; x--) {
+            if(a->lut[ra[x]] != b->lut[rb[x]]) {
+                right = x;
+                break;
+            }
+        }
+    }
+    rect[0] = left;
+    rect[1] = top;
+    rect[2] = right - left + 1;
+    rect[3] = bottom - top + 1;
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    int rval = -1;
+    int fd = -1;
+    FILE *fo = NULL;
+    char *fi_name = NULL;
+    char *fo_name = NULL;
+    int delay = DEF_DELAY;
+    int loops = 0;
+    info_t *slide_info = NULL;
+    pipeline_t pipe = {0};
+    pthread_t tid;
+    bool started = false;
+    bool created = false;
+    int encoded = 0;
+    uint64_t area = 0;
+
+    printf("MPSgif - MPSShow Animated GIF Exporter\n");
+
+    char *prog = filename(argv[0]);
+    argv++; argc--; // consume the first arg (program name)
+
+    // parse any options
+    while((argc) && ('-' == argv[0][0])) {
+        if((0 == strcmp(argv[0], "-d")) && (argc > 1)) {
+            delay = atoi(argv[1]);
+            argv += 2; argc -= 2; // consume the option and its value
+        } else if((0 == strcmp(argv[0], "-l")) && (argc > 1)) {
+            loops = atoi(argv[1]);
+            argv += 2; argc -= 2; // consume the option and its value
+        } else {
+            printf("ERROR: Unknown option '%s'\n", argv[0]);
+            argc = 0; // force the usage message
+        }
+    }
+
+    if((argc < 1) || (argc > 2) || (delay < 0) || (delay > 0xffff) || (loops < GIF_LOOP_NONE) || (loops > 0xffff)) {
+        printf("USAGE: %s <options> [infile] <outfile>\n", prog);
+        printf("[infile] is the name of the input MPS file to export\n");
+        printf("<outfile> optional name for the output GIF file\n");
+        printf("<options>\n");
+        printf("  -d [delay]   time to show each slide, in 1/100ths of a second (default %d)\n", DEF_DELAY);
+        printf("  -l [loops]   times to repeat the show, 0 for forever (default), -1 to play once\n");
+        return -1;
+    }
+
+    // get the file names from the command line
+    int namelen = strlen(argv[0]);
+    if(NULL == (fi_name = calloc(1, namelen+1))) {
+        printf("Unable to allocate memory\n");
+        goto CLEANUP;
+    }
+    strncpy(fi_name, argv[0], namelen);
+    argv++; argc--; // consume the arg (input file)
+
+    if(argc) { // output name was given
+        namelen = strlen(argv[0]);
+        if(NULL == (fo_name = calloc(1, namelen+1))) {
+            printf("Unable to allocate memory\n");
+            goto CLEANUP;
+        }
+        strncpy(fo_name, argv[0], namelen);
+    } else { // otherwise use the input name with a new extension
+        if(NULL == (fo_name = calloc(1, namelen+5))) {
+            printf("Unable to allocate memory\n");
+            goto CLEANUP;
+        }
+        strncpy(fo_name, fi_name, namelen);
+        drop_extension(fo_name); // remove exisiting extension
+        strncat(fo_name, OUTEXT, namelen+4); // add gif extension
+    }
+
+    // open the input file
+    printf("Opening MPS File: '%s'\n", fi_name);
+    if((fd = open(fi_name, O_RDONLY)) < 0) {
+        printf("Error: Unable to open input file\n");
+        goto CLEANUP;
+    }
+
+    // read in the mpsshow information block
+    int num_slides = -1;
+    if(NULL == (slide_info = read_mps_show_info_header_fd(fd, &num_slides))) {
+        printf("Error reading MPSShow info block\n");
+        goto CLEANUP;
+    }
+    printf("Number of slides: %d\n", num_slides);
+    if(num_slides < 1) {
+        printf("Error: No slides to export\n");
+        goto CLEANUP;
+    }
+
+    // allocate the frame slots
+    for(int i = 0; i < NUM_SLOTS; i++) {
+        if(NULL == (pipe.frame[i].idx = calloc(1, FRAME_PIXELS))) {
+            printf("Unable to allocate memory\n");
+            goto CLEANUP;
+        }
+    }
+
+    printf("Saving: '%s'\n", fo_name);
+    if(NULL == (fo = fopen(fo_name, "wb"))) {
+        printf("Error: Unable to create output file\n");
+        goto CLEANUP;
+    }
+    created = true;
+    setvbuf(fo, NULL, _IOFBF, OUTBUFSZ);
+    if(0 != gif_write_header(fo, MPS_WIDTH, MPS_HEIGHT, loops)) {
+        printf("Error: Unable to write to output file\n");
+        goto CLEANUP;
+    }
+
+    // start decoding
+    pipe.fd = fd;
+    pipe.slide_info = slide_info;
+    pipe.num_slides = num_slides;
+    pthread_mutex_init(&pipe.lock, NULL);
+    pthread_cond_init(&pipe.cond, NULL);
+    if(0 != pthread_create(&tid, NULL, decoder, &pipe)) {
+        printf("Error: Unable to start the decoding thread\n");
+        goto CLEANUP;
+    }
+    started = true;
+
+    // encode each frame as it becomes ready
+    for(int i = 0; i < num_slides; i++) {
+        pthread_mutex_lock(&pipe.lock);
+        while(pipe.decoded <= i) {
+            pthread_cond_wait(&pipe.cond, &pipe.lock);
+        }
+        pthread_mutex_unlock(&pipe.lock);
+
+        frame_t *f = &pipe.frame[i % NUM_SLOTS];
+        if(f->err) {
+            printf("Error: Unable to read image %d\n", i + 1);
+            goto CLEANUP;
+        }
+
+        // only the part that changed is needed, the first frame is always whole, and a
+        // frame that changes nothing still needs a pixel to carry its delay
+        int rect[4] = {0, 0, MPS_WIDTH, MPS_HEIGHT};
+        if(i > 0) {
+            if(!diff_rect(&pipe.frame[(i - 1) % NUM_SLOTS], f, rect)) {
+                rect[2] = rect[3] = 1;
+            }
+        }
+
+        pal_entry_t pal[256];
+        pal6_to_pal8(slide_info[i].pal, pal, 256);
+        if(0 != gif_write_frame(fo, f->idx, MPS_WIDTH, rect[0], rect[1], rect[2], rect[3], pal, delay)) {
+            printf("Error: Unable to write to output file\n");
+            goto CLEANUP;
+        }
+        area += (uint64_t)rect[2] * rect[3];
+        encoded++;
+
+        // the previous frame is no longer needed
+        pthread_mutex_lock(&pipe.lock);
+        pipe.released = i;
+        pthread_cond_broadcast(&pipe.cond);
+        pthread_mutex_unlock(&pipe.lock);
+    }
+
+    if((0 != gif_write_end(fo)) || (0 != fflush(fo))) {
+        printf("Error: Unable to write to output file\n");
+        goto CLEANUP;
+    }
+    printf("Frames: %d\tArea encoded: %.1f%%\tFile Size: %ld\n", encoded,
+        (100.0 * area) / ((uint64_t)encoded * FRAME_PIXELS), ftell(fo));
+
+    rval = 0; // clean exit
+
+CLEANUP:
+    if(started) {
+        pthread_mutex_lock(&pipe.lock);
+        pipe.stop = true;
+        pthread_cond_broadcast(&pipe.cond);
+        pthread_mutex_unlock(&pipe.lock);
+        pthread_join(tid, NULL);
+        pthread_mutex_destroy(&pipe.lock);
+        pthread_cond_destroy(&pipe.cond);
+    }
+    for(int i = 0; i < NUM_SLOTS; i++) {
+        free_s(pipe.frame[i].idx);
+    }
+    if(fd >= 0) {
+        close(fd);
+    }
+    fclose_s(fo);
+    if((0 != rval) && (created)) {
+        remove(fo_name); // don't leave a partial image behind
+    }
+    free_s(slide_info);
+    free_s(fi_name);
+    free_s(fo_name);
+    return rval;
+}
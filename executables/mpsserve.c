@@ -0,0 +1,783 @@
+/*
+ * MPSserve.c
+ * Long running server that keeps a set of MPSShow data files (.MPS) open and serves
+ * their slide listings, metadata, palettes, and images over a Unix domain socket.
+ * Decoded slides are held in a frame cache so repeated requests skip the decode.
+ *
+ * Requests are single text lines, one of
+ *   SHOWS                          list the shows being served
+ *   LIST  [show]                   list the slides in a show
+ *   META  [show] [slide]           metadata for a slide
+ *   PAL   [show] [slide]           768 byte VGA palette (0-63 per component)
+ *   IMG   [show] [slide] <format>  image as 'raw' indexed data (default), 'bmp', or 'rgb'
+ *   STATS                          request latency and cache statistics
+ * shows and slides are numbered from 1. Each response starts with a text line, either
+ * "OK <length>" followed by <length> bytes of payload, or "ERR <message>".
+ *
+ * To obtain the .MPS file you can use 'MPSextract' on a MPSShow slideshow demo exe file
+ *
+ * This code is offered without warranty under the MIT License. Use it as you will
+ * personally or commercially, just give credit if you do.
+ */
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include "util.h"
+#include "mps-show.h"
+#include "mps-meta.h"
+#include "pal-tools.h"
+#include "bmp.h"
+
+#define IMAGE_WIDTH (320)
+#define IMAGE_HEIGHT (200)
+#define IMAGE_SIZE (IMAGE_WIDTH * IMAGE_HEIGHT)
+
+#define DEF_WORKERS (4)       // default number of worker threads
+#define DEF_CACHE   (256)     // default number of decoded frames to cache
+#define MAX_CLIENTS (256)     // maximum number of simultaneous connections
+#define LINESZ      (1024)    // maximum length of a request line
+#define LAT_BUCKETS (32)      // latency histogram buckets, log2 of microseconds
+#define SEND_TIMEOUT (5)      // seconds a worker waits for a client to take a response
+
+// a show being served
+typedef struct {
+    char        *name;        // file name of the show
+    int         fd;           // open descriptor for the show, shared by all workers
+    int         num_slides;   // number of slides in the show
+    mps_meta_t  *meta;        // slide information, in its compact form
+} show_t;
+
+// a decoded frame held in the cache
+typedef struct frame_s {
+    uint32_t    key;          // (show << 8) | slide, 0 if unused
+    struct frame_s *next;     // hash chain
+    struct frame_s *newer;    // LRU list, towards most recently used
+    struct frame_s *older;    // LRU list, towards least recently used
+    uint8_t     *data;        // IMAGE_SIZE bytes of indexed image data
+} frame_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    int         count;        // number of frames in the cache
+    int         nbuckets;     // number of hash buckets, power of 2
+    frame_t     **buckets;    // hash buckets
+    frame_t     *frames;      // all frames
+    frame_t     *newest;      // head of the LRU list
+    frame_t     *oldest;      // tail of the LRU list
+    uint64_t    hits;
+    uint64_t    misses;
+} cache_t;
+
+// a connected client
+typedef struct {
+    int         fd;           // socket, -1 if the slot is free
+    bool        busy;         // a request is being handled by a worker
+    size_t      inlen;        // bytes in inbuf
+    char        inbuf[LINESZ];
+} client_t;
+
+// a request handed to the worker pool
+typedef struct {
+    int         slot;         // client slot the request came from
+    int         fd;           // socket to write the response to
+    struct timespec start;    // time the request was received
+    char        line[LINESZ]; // the request line
+} job_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t  ready;
+    job_t       jobs[MAX_CLIENTS]; // each client has at most one job queued
+    int         head;
+    int         count;
+    bool        quit;
+} queue_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    uint64_t    requests;
+    uint64_t    errors;
+    uint64_t    total_ns;
+    uint64_t    max_ns;
+    uint64_t    hist[LAT_BUCKETS];
+} stats_t;
+
+static show_t *shows = NULL;
+static int num_shows = 0;
+static cache_t cache;
+static queue_t queue;
+static stats_t stats;
+static int wake_pipe[2] = {-1, -1};   // workers post finished client slots here
+static volatile sig_atomic_t quit = 0;
+
+static void on_signal(int sig) {
+    (void)sig;
+    quit = 1;
+}
+
+/// @brief initializes the frame cache
+/// @param capacity maximum number of frames to hold
+/// @return 0 on success
+static int cache_init(cache_t *c, int capacity) {
+    memset(c, 0, sizeof(cache_t));
+    pthread_mutex_init(&c->lock, NULL);
+    c->nbuckets = 1;
+    while(c->nbuckets < (capacity * 2)) c->nbuckets <<= 1;
+    if(NULL == (c->buckets = calloc(c->nbuckets, sizeof(frame_t *)))) {
+        return -1;
+    }
+    if(NULL == (c->frames = calloc(capacity, sizeof(frame_t)))) {
+        return -1;
+    }
+    for(int i = 0; i < capacity; i++) {
+        if(NULL == (c->frames[i].data = malloc(IMAGE_SIZE))) {
+            return -1;
+        }
+    }
+    c->count = capacity;
+    // all frames start out unused, at the old end of the LRU list
+    for(int i = 0; i < capacity; i++) {
+        frame_t *f = &c->frames[i];
+        f->older = c->newest;
+        if(c->newest) c->newest->newer = f;
+        c->newest = f;
+        if(NULL == c->oldest) c->oldest = f;
+    }
+    return 0;
+}
+
+static void cache_free(cache_t *c) {
+    if(c->frames) {
+        for(int i = 0; i < c->count; i++) {
+            free_s(c->frames[i].data);
+        }
+    }
+    free_s(c->frames);
+    free_s(c->buckets);
+}
+
+static inline uint32_t cache_hash(cache_t *c, uint32_t key) {
+    return (key * 2654435761u) & (c->nbuckets - 1);
+}
+
+/// @brief moves the frame to the most recently used end of the LRU list
+static void cache_touch(cache_t *c, frame_t *f) {
+    if(c->newest == f) return;
+    // unlink
+    if(f->older) f->older->newer = f->newer;
+    if(f->newer) f->newer->older = f->older;
+    if(c->oldest == f) c->oldest = f->newer;
+    // link at the head
+    f->newer = NULL;
+    f->older = c->newest;
+    c->newest->newer = f;
+    c->newest = f;
+}
+
+/// @brief copies a frame out of the cache
+/// @return true if the frame was found
+static bool cache_get(cache_t *c, uint32_t key, uint8_t *dst) {
+    bool found = false;
+    pthread_mutex_lock(&c->lock);
+    for(frame_t *f = c->buckets[cache_hash(c, key)]; f; f = f->next) {
+        if(f->key == key) {
+            memcpy(dst, f->data, IMAGE_SIZE);
+            cache_touch(c, f);
+            found = true;
+            break;
+        }
+    }
+    if(found) c->hits++; else c->misses++;
+    pthread_mutex_unlock(&c->lock);
+    return found;
+}
+
+/// @brief adds a frame to the cache, evicting the least recently used frame
+static void cache_put(cache_t *c, uint32_t key, uint8_t *src) {
+    pthread_mutex_lock(&c->lock);
+    // another worker may have decoded the same frame at the same time
+    for(frame_t *f = c->buckets[cache_hash(c, key)]; f; f = f->next) {
+        if(f->key == key) {
+            pthread_mutex_unlock(&c->lock);
+            return;
+        }
+    }
+    frame_t *f = c->oldest;
+    if(f->key) { // evict from the hash chain
+        frame_t **pp = &c->buckets[cache_hash(c, f->key)];
+        while(*pp != f) pp = &(*pp)->next;
+        *pp = f->next;
+    }
+    f->key = key;
+    memcpy(f->data, src, IMAGE_SIZE);
+    uint32_t h = cache_hash(c, key);
+    f->next = c->buckets[h];
+    c->buckets[h] = f;
+    cache_touch(c, f);
+    pthread_mutex_unlock(&c->lock);
+}
+
+/// @brief writes all of the buffer to the socket, the sockets have a send timeout, so
+/// a client that stops reading cannot hold a worker for ever
+/// @return 0 on success
+static int write_all(int fd, const void *buf, size_t len) {
+    const uint8_t *p = buf;
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while(len) {
+        ssize_t nw = send(fd, p, len, MSG_NOSIGNAL);
+        if((nw < 0) && (EINTR == errno)) {
+            continue;
+        }
+        // the timeout applies to each send(), so a client taking a little at a time is
+        // held to it for the whole buffer too
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if((nw < 0) || (((size_t)nw < len) && ((now.tv_sec - start.tv_sec) >= SEND_TIMEOUT))) {
+            // the response is incomplete, so end the connection, the event loop sees it
+            // closed and frees the slot
+            shutdown(fd, SHUT_RDWR);
+            return -1;
+        }
+        p += nw;
+        len -= nw;
+    }
+    return 0;
+}
+
+/// @brief sends an OK response with its payload
+static int reply_ok(int fd, const void *payload, size_t len) {
+    char hdr[32];
+    int n = snprintf(hdr, sizeof(hdr), "OK %zu\n", len);
+    if(0 != write_all(fd, hdr, n)) return -1;
+    return write_all(fd, payload, len);
+}
+
+/// @brief sends an ERR response
+static int reply_err(int fd, const char *msg) {
+    char buf[128];
+    int n = snprintf(buf, sizeof(buf), "ERR %s\n", msg);
+    write_all(fd, buf, n);
+    return -1;
+}
+
+/// @brief looks up the show and slide named in the request arguments
+/// @return 0 on success, with the 0 based indexes set
+static int get_slide(int fd, const char *arg1, const char *arg2, int *show, int *slide) {
+    *show = (arg1) ? atoi(arg1) : 0;
+    if((*show < 1) || (*show > num_shows)) {
+        return reply_err(fd, "invalid show");
+    }
+    (*show)--;
+    if(NULL == slide) return 0;
+    *slide = (arg2) ? atoi(arg2) : 0;
+    if((*slide < 1) || (*slide > shows[*show].num_slides)) {
+        return reply_err(fd, "invalid slide");
+    }
+    (*slide)--;
+    return 0;
+}
+
+/// @brief gets the decoded image for a slide, from the cache if possible
+/// @return 0 on success
+static int get_frame(int show, int slide, uint8_t *dst) {
+    uint32_t key = ((uint32_t)(show + 1) << 8) | slide;
+    if(cache_get(&cache, key, dst)) {
+        return 0;
+    }
+
+    // positional reads, so no locking is needed around the shared descriptor, and only
+    // the image's offset and length are needed, not its full slide record
+    show_t *s = &shows[show];
+    memstream_buf_t src = {0, 0, NULL};
+    memstream_buf_t img = {IMAGE_SIZE, 0, dst};
+    memset(dst, 0, IMAGE_SIZE);
+    if(0 != read_mps_show_rle_at_fd(&src, s->fd, s->meta->img_offset[slide], s->meta->img_len[slide])) {
+        return -1;
+    }
+    int rval = rle_decompress(&img, &src);
+    free_s(src.data);
+    if(0 != rval) {
+        return -1;
+    }
+    cache_put(&cache, key, dst);
+    return 0;
+}
+
+/// @brief gets the image for a slide as 24 bit RGB. The indexed frame comes through
+/// get_frame(), so a miss is cached for later requests in any format, and its colours
+/// are then looked up.
+/// @param img buffer of IMAGE_SIZE bytes for the indexed frame
+/// @param pal the slide's palette, 8 bits per component
+/// @return 0 on success
+static int get_rgb(int show, int slide, uint8_t *img, const pal_entry_t *pal, uint8_t *dst) {
+    if(0 != get_frame(show, slide, img)) {
+        return -1;
+    }
+    for(int i = 0; i < IMAGE_SIZE; i++) {
+        const pal_entry_t *c = &pal[img[i]];
+        dst[i * 3 + 0] = c->r;
+        dst[i * 3 + 1] = c->g;
+        dst[i * 3 + 2] = c->b;
+    }
+    return 0;
+}
+
+/// @brief formats the statistics report
+static size_t format_stats(char *buf, size_t sz) {
+    pthread_mutex_lock(&stats.lock);
+    uint64_t req = stats.requests;
+    uint64_t hist[LAT_BUCKETS];
+    memcpy(hist, stats.hist, sizeof(hist));
+    double mean_us = (req) ? (stats.total_ns / 1000.0) / req : 0.0;
+    double max_us = stats.max_ns / 1000.0;
+    uint64_t errors = stats.errors;
+    pthread_mutex_unlock(&stats.lock);
+
+    pthread_mutex_lock(&cache.lock);
+    uint64_t hits = cache.hits;
+    uint64_t misses = cache.misses;
+    pthread_mutex_unlock(&cache.lock);
+
+    // percentiles are reported as the upper bound of the histogram bucket
+    uint64_t p50 = 0, p99 = 0, acc = 0;
+    for(int i = 0; i < LAT_BUCKETS; i++) {
+        acc += hist[i];
+        if((0 == p50) && (acc * 2 >= req) && req) p50 = 1ull << i;
+        if((0 == p99) && (acc * 100 >= req * 99) && req) p99 = 1ull << i;
+    }
+
+    double rate = (hits + misses) ? (100.0 * hits) / (hits + misses) : 0.0;
+    return snprintf(buf, sz,
+        "requests: %llu\nerrors: %llu\nlatency_mean_us: %.1f\nlatency_max_us: %.1f\n"
+        "latency_p50_us: <%llu\nlatency_p99_us: <%llu\n"
+        "cache_frames: %d\ncache_hits: %llu\ncache_misses: %llu\ncache_hit_rate: %.1f%%\n",
+        (unsigned long long)req, (unsigned long long)errors, mean_us, max_us,
+        (unsigned long long)p50, (unsigned long long)p99,
+        cache.count, (unsigned long long)hits, (unsigned long long)misses, rate);
+}
+
+/// @brief handles a single request line, writing the response to the socket
+/// @return 0 on success
+static int handle_request(int fd, char *line) {
+    char *save = NULL;
+    char *cmd = strtok_r(line, " \t\r\n", &save);
+    char *arg1 = strtok_r(NULL, " \t\r\n", &save);
+    char *arg2 = strtok_r(NULL, " \t\r\n", &save);
+    char *arg3 = strtok_r(NULL, " \t\r\n", &save);
+    int show, slide;
+    int rval = -1;
+    char *txt = NULL;
+    uint8_t *img = NULL;
+    uint8_t *out = NULL;
+
+    if(NULL == cmd) {
+        return reply_err(fd, "empty request");
+    }
+
+    if(0 == strcmp(cmd, "SHOWS")) {
+        // room for each name plus the number, slide count and fixed text around it
+        size_t sz = 1;
+        for(int i = 0; i < num_shows; i++) {
+            sz += strlen(shows[i].name) + 48;
+        }
+        if(NULL == (txt = malloc(sz))) goto nomem;
+        size_t n = 0;
+        for(int i = 0; i < num_shows; i++) {
+            n += snprintf(&txt[n], sz - n, "%d: %s slides:%d\n", i + 1, shows[i].name, shows[i].num_slides);
+        }
+        rval = reply_ok(fd, txt, n);
+
+    } else if(0 == strcmp(cmd, "LIST")) {
+        if(0 != get_slide(fd, arg1, NULL, &show, NULL)) return -1;
+        show_t *s = &shows[show];
+        size_t sz = 128 * (s->num_slides + 1);
+        if(NULL == (txt = malloc(sz))) goto nomem;
+        size_t n = 0;
+        mps_meta_t *m = s->meta;
+        for(int i = 0; i < s->num_slides; i++) {
+            n += snprintf(&txt[n], sz - n, "%2d: %9s - %-25s ofs:%06x len:%-6d mode:%02xh [%08x]\n", i+1,
+                mps_meta_name(m, i), mps_meta_desc(m, i),
+                m->img_offset[i], m->img_len[i], m->mode[i], m->unknown32[i]);
+        }
+        rval = reply_ok(fd, txt, n);
+
+    } else if(0 == strcmp(cmd, "META")) {
+        if(0 != get_slide(fd, arg1, arg2, &show, &slide)) return -1;
+        mps_meta_t *m = shows[show].meta;
+        char buf[256];
+        int n = snprintf(buf, sizeof(buf),
+            "name: %s\ndesc: %s\noffset: %u\nlength: %u\nmode: %u\nunknown32: %08x\nwidth: %d\nheight: %d\n",
+            mps_meta_name(m, slide), mps_meta_desc(m, slide),
+            m->img_offset[slide], m->img_len[slide], m->mode[slide], m->unknown32[slide], IMAGE_WIDTH, IMAGE_HEIGHT);
+        rval = reply_ok(fd, buf, n);
+
+    } else if(0 == strcmp(cmd, "PAL")) {
+        if(0 != get_slide(fd, arg1, arg2, &show, &slide)) return -1;
+        rval = reply_ok(fd, mps_meta_palette(shows[show].meta, slide), sizeof(pal_entry_t) * 256);
+
+    } else if(0 == strcmp(cmd, "IMG")) {
+        if(0 != get_slide(fd, arg1, arg2, &show, &slide)) return -1;
+        const char *fmt = (arg3) ? arg3 : "raw";
+        if(strcmp(fmt, "raw") && strcmp(fmt, "bmp") && strcmp(fmt, "rgb")) {
+            return reply_err(fd, "invalid format");
+        }
+        pal_entry_t pal[256];
+        pal6_to_pal8((pal_entry_t *)mps_meta_palette(shows[show].meta, slide), pal, 256);
+        if(NULL == (img = malloc(IMAGE_SIZE))) goto nomem;
+        if(0 == strcmp(fmt, "rgb")) {
+            if(NULL == (out = malloc(IMAGE_SIZE * 3))) goto nomem;
+            if(0 != get_rgb(show, slide, img, pal, out)) {
+                rval = reply_err(fd, "unable to read image");
+                goto cleanup;
+            }
+            rval = reply_ok(fd, out, IMAGE_SIZE * 3);
+            goto cleanup;
+        }
+        if(0 != get_frame(show, slide, img)) {
+            rval = reply_err(fd, "unable to read image");
+            goto cleanup;
+        }
+
+        if(0 == strcmp(fmt, "raw")) {
+            rval = reply_ok(fd, img, IMAGE_SIZE);
+        } else if(0 == strcmp(fmt, "bmp")) {
+            memstream_buf_t src = {IMAGE_SIZE, 0, img};
+            memstream_buf_t dst = {bmp_size(IMAGE_WIDTH, IMAGE_HEIGHT), 0, NULL};
+            if(NULL == (out = malloc(dst.len))) goto nomem;
+            dst.data = out;
+            encode_bmp(&dst, &src, IMAGE_WIDTH, IMAGE_HEIGHT, pal);
+            rval = reply_ok(fd, out, dst.pos);
+        }
+
+    } else if(0 == strcmp(cmd, "STATS")) {
+        char buf[512];
+        size_t n = format_stats(buf, sizeof(buf));
+        rval = reply_ok(fd, buf, n);
+
+    } else {
+        rval = reply_err(fd, "unknown request");
+    }
+
+cleanup:
+    free_s(txt);
+    free_s(img);
+    free_s(out);
+    return rval;
+
+nomem:
+    reply_err(fd, "out of memory");
+    rval = -1;
+    goto cleanup;
+}
+
+/// @brief worker thread, takes requests from the queue and handles them
+static void *worker(void *arg) {
+    (void)arg;
+    for(;;) {
+        job_t job;
+        pthread_mutex_lock(&queue.lock);
+        while((0 == queue.count) && (!queue.quit)) {
+            pthread_cond_wait(&queue.ready, &queue.lock);
+        }
+        if(queue.quit) {
+            pthread_mutex_unlock(&queue.lock);
+            break;
+        }
+        job = queue.jobs[queue.head];
+        queue.head = (queue.head + 1) % MAX_CLIENTS;
+        queue.count--;
+        pthread_mutex_unlock(&queue.lock);
+
+        int rval = handle_request(job.fd, job.line);
+
+        // record the latency from receipt of the request to the response being sent
+        struct timespec end;
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        uint64_t ns = (uint64_t)(end.tv_sec - job.start.tv_sec) * 1000000000ull + (end.tv_nsec - job.start.tv_nsec);
+        int b = 0;
+        while(((ns / 1000) >> b) && (b < (LAT_BUCKETS - 1))) b++;
+        pthread_mutex_lock(&stats.lock);
+        stats.requests++;
+        if(0 != rval) stats.errors++;
+        stats.total_ns += ns;
+        if(ns > stats.max_ns) stats.max_ns = ns;
+        stats.hist[b]++;
+        pthread_mutex_unlock(&stats.lock);
+
+        // hand the client back to the event loop
+        int slot = job.slot;
+        while((write(wake_pipe[1], &slot, sizeof(slot)) < 0) && (EINTR == errno));
+    }
+    return NULL;
+}
+
+/// @brief queues the first complete request line from the client's input, if any
+static void dispatch(client_t *cl, int slot) {
+    char *nl = memchr(cl->inbuf, '\n', cl->inlen);
+    if(NULL == nl) {
+        return;
+    }
+    size_t len = nl - cl->inbuf + 1;
+
+    pthread_mutex_lock(&queue.lock);
+    job_t *job = &queue.jobs[(queue.head + queue.count) % MAX_CLIENTS];
+    job->slot = slot;
+    job->fd = cl->fd;
+    clock_gettime(CLOCK_MONOTONIC, &job->start);
+    memcpy(job->line, cl->inbuf, len);
+    job->line[len - 1] = 0;
+    queue.count++;
+    pthread_cond_signal(&queue.ready);
+    pthread_mutex_unlock(&queue.lock);
+
+    // remove the line from the input buffer
+    memmove(cl->inbuf, &cl->inbuf[len], cl->inlen - len);
+    cl->inlen -= len;
+    cl->busy = true;
+}
+
+static void close_client(client_t *cl) {
+    close(cl->fd);
+    cl->fd = -1;
+    cl->busy = false;
+    cl->inlen = 0;
+}
+
+int main(int argc, char *argv[]) {
+    int rval = -1;
+    int lfd = -1;
+    int num_workers = DEF_WORKERS;
+    int cache_frames = DEF_CACHE;
+    char *sock_name = NULL;
+    pthread_t *threads = NULL;
+    int num_threads = 0;
+    client_t *clients = NULL;
+
+    printf("MPSserve - MPSShow Slide Server\n");
+
+    char *prog = filename(argv[0]);
+    argv++; argc--; // consume the first arg (program name)
+
+    // parse any options, these come before the positional args
+    while((argc) && ('-' == argv[0][0])) {
+        if((0 == strcmp(argv[0], "-w")) && (argc > 1)) {
+            num_workers = atoi(argv[1]);
+            argv += 2; argc -= 2; // consume the option and its value
+        } else if((0 == strcmp(argv[0], "-c")) && (argc > 1)) {
+            cache_frames = atoi(argv[1]);
+            argv += 2; argc -= 2; // consume the option and its value
+        } else {
+            printf("ERROR: Unknown option '%s'\n", argv[0]);
+            argc = 0; // force the usage message
+        }
+    }
+
+    if((argc < 2) || (num_workers < 1) || (cache_frames < 1)) {
+        printf("USAGE: %s <options> [socket] [infile] <infile...>\n", prog);
+        printf("[socket] is the path of the Unix domain socket to listen on\n");
+        printf("[infile] is the name of an MPS file to serve, any number may be given\n");
+        printf("<options>\n");
+        printf("  -w [count]  number of worker threads (default %d)\n", DEF_WORKERS);
+        printf("  -c [count]  number of decoded frames to cache (default %d)\n", DEF_CACHE);
+        return -1;
+    }
+    sock_name = argv[0];
+    argv++; argc--; // consume the arg (socket)
+
+    // open all the shows
+    if(NULL == (shows = calloc(argc, sizeof(show_t)))) {
+        printf("Unable to allocate memory\n");
+        goto CLEANUP;
+    }
+    for(int i = 0; i < argc; i++) {
+        show_t *s = &shows[num_shows];
+        s->name = argv[i];
+        printf("Opening MPS File: '%s'", s->name);
+        if((s->fd = open(s->name, O_RDONLY)) < 0) {
+            printf("\tError: Unable to open input file\n");
+            goto CLEANUP;
+        }
+        if(NULL == (s->meta = read_mps_show_meta_fd(s->fd))) {
+            printf("\tError reading MPSShow info block\n");
+            close(s->fd);
+            goto CLEANUP;
+        }
+        s->num_slides = s->meta->count;
+        printf("\tNumber of slides: %d\n", s->num_slides);
+        num_shows++;
+    }
+
+    if(0 != cache_init(&cache, cache_frames)) {
+        printf("Unable to allocate memory\n");
+        goto CLEANUP;
+    }
+    if(NULL == (clients = calloc(MAX_CLIENTS, sizeof(client_t)))) {
+        printf("Unable to allocate memory\n");
+        goto CLEANUP;
+    }
+    for(int i = 0; i < MAX_CLIENTS; i++) {
+        clients[i].fd = -1;
+    }
+
+    // create the listening socket
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(strlen(sock_name) >= sizeof(addr.sun_path)) {
+        printf("Error: Socket path too long\n");
+        goto CLEANUP;
+    }
+    strncpy(addr.sun_path, sock_name, sizeof(addr.sun_path) - 1);
+    unlink(sock_name);
+    if((lfd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+        printf("Error: Unable to create socket\n");
+        goto CLEANUP;
+    }
+    if((0 != bind(lfd, (struct sockaddr *)&addr, sizeof(addr))) || (0 != listen(lfd, 64))) {
+        printf("Error: Unable to listen on '%s'\n", sock_name);
+        goto CLEANUP;
+    }
+    if(0 != pipe(wake_pipe)) {
+        printf("Error: Unable to create pipe\n");
+        goto CLEANUP;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    signal(SIGPIPE, SIG_IGN);
+
+    // start up the worker pool
+    pthread_mutex_init(&queue.lock, NULL);
+    pthread_cond_init(&queue.ready, NULL);
+    pthread_mutex_init(&stats.lock, NULL);
+    if(NULL == (threads = calloc(num_workers, sizeof(pthread_t)))) {
+        printf("Unable to allocate memory\n");
+        goto CLEANUP;
+    }
+    for(; num_threads < num_workers; num_threads++) {
+        if(0 != pthread_create(&threads[num_threads], NULL, worker, NULL)) {
+            printf("Error: Unable to create worker thread\n");
+            goto CLEANUP;
+        }
+    }
+
+    printf("Listening on: '%s'\tWorkers: %d\tCache: %d frames\n", sock_name, num_workers, cache_frames);
+    fflush(stdout);
+
+    // event loop, watch the listening socket, the wake pipe, and all idle clients
+    struct pollfd pfd[MAX_CLIENTS + 2];
+    int pslot[MAX_CLIENTS + 2];
+    while(!quit) {
+        int np = 0;
+        pfd[np].fd = lfd; pfd[np].events = POLLIN; pslot[np++] = -1;
+        pfd[np].fd = wake_pipe[0]; pfd[np].events = POLLIN; pslot[np++] = -1;
+        for(int i = 0; i < MAX_CLIENTS; i++) {
+            if((clients[i].fd >= 0) && (!clients[i].busy)) {
+                pfd[np].fd = clients[i].fd;
+                pfd[np].events = POLLIN;
+                pslot[np++] = i;
+            }
+        }
+
+        int nready = poll(pfd, np, -1);
+        if(nready < 0) {
+            if(EINTR == errno) continue;
+            printf("Error: poll failed\n");
+            goto CLEANUP;
+        }
+
+        // new connections
+        if(pfd[0].revents & POLLIN) {
+            int cfd = accept(lfd, NULL, NULL);
+            if(cfd >= 0) {
+                // responses are sent by the workers, a client that stops reading would
+                // otherwise block one in send() for as long as it stays connected
+                struct timeval tv = {SEND_TIMEOUT, 0};
+                setsockopt(cfd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+                int i;
+                for(i = 0; (i < MAX_CLIENTS) && (clients[i].fd >= 0); i++);
+                if(i < MAX_CLIENTS) {
+                    clients[i].fd = cfd;
+                } else {
+                    close(cfd); // too many clients
+                }
+            }
+        }
+
+        // clients whose requests have been completed by a worker
+        if(pfd[1].revents & POLLIN) {
+            int slots[64];
+            ssize_t nr = read(wake_pipe[0], slots, sizeof(slots));
+            for(int j = 0; j < (nr / (ssize_t)sizeof(int)); j++) {
+                client_t *cl = &clients[slots[j]];
+                cl->busy = false;
+                dispatch(cl, slots[j]); // pipelined request already buffered
+            }
+        }
+
+        // incoming request data
+        for(int j = 2; j < np; j++) {
+            if(0 == pfd[j].revents) continue;
+            client_t *cl = &clients[pslot[j]];
+            if(cl->busy) continue; // picked up a pipelined request above
+            ssize_t nr = read(cl->fd, &cl->inbuf[cl->inlen], LINESZ - cl->inlen);
+            if(nr <= 0) {
+                close_client(cl);
+                continue;
+            }
+            cl->inlen += nr;
+            if((LINESZ == cl->inlen) && (NULL == memchr(cl->inbuf, '\n', cl->inlen))) {
+                reply_err(cl->fd, "request too long");
+                close_client(cl);
+                continue;
+            }
+            dispatch(cl, pslot[j]);
+        }
+    }
+    printf("Shutting down\n");
+    rval = 0; // clean exit
+
+CLEANUP:
+    // stop the worker pool
+    pthread_mutex_lock(&queue.lock);
+    queue.quit = true;
+    pthread_cond_broadcast(&queue.ready);
+    pthread_mutex_unlock(&queue.lock);
+    for(int i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free_s(threads);
+
+    if(clients) {
+        for(int i = 0; i < MAX_CLIENTS; i++) {
+            if(clients[i].fd >= 0) close(clients[i].fd);
+        }
+    }
+    free_s(clients);
+    if(lfd >= 0) {
+        close(lfd);
+        unlink(sock_name);
+    }
+    if(wake_pipe[0] >= 0) close(wake_pipe[0]);
+    if(wake_pipe[1] >= 0) close(wake_pipe[1]);
+    cache_free(&cache);
+    for(int i = 0; i < num_shows; i++) {
+        close(shows[i].fd);
+        mps_meta_free(shows[i].meta);
+    }
+    free_s(shows);
+    return rval;
+}
@@ -0,0 +1,232 @@
+/*
+ * MPSshm.c
+ * Passes decoded slides between processes through a shared memory frame ring, rather
+ * than through image files on disk.
+ *
+ * As the producer (-p) it creates the ring and decodes every slide of the given .MPS
+ * files straight into it. As the consumer (-c) it maps the same ring and reads the frames
+ * in place, listing each one with a CRC-32C of its image and palette. The consumer is an
+ * example of a renderer or analysis process, and can be used to check the handoff.
+ *
+ * To obtain the .MPS file you can use 'MPSextract' on a MPSShow slideshow demo exe file
+ *
+ * This code is offered without warranty under the MIT License. Use it as you will
+ * personally or commercially, just give credit if you do.
+ */
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "util.h"
+#include "crc32c.h"
+#include "mps-show.h"
+#include "mps-ring.h"
+
+#define DEF_TIMEOUT (5000)  // time the consumer waits for a frame, in ms
+#define POLL_MS     (10)    // time between attempts to open the ring
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void nap_ms(int ms) {
+    struct timespec ts = {ms / 1000, (ms % 1000) * 1000000L};
+    nanosleep(&ts, NULL);
+}
+
+/// @brief decodes every slide of the files into the ring
+/// @return 0 on success
+static int produce(mps_ring_t *ring, char **files, int num_files, int delay_ms) {
+    uint64_t frames = 0;
+    double t0 = now();
+
+    for(int f = 0; f < num_files; f++) {
+        int fd = -1;
+        int num_slides = -1;
+        info_t *slide_info = NULL;
+
+        if(((fd = open(files[f], O_RDONLY)) < 0) ||
+           (NULL == (slide_info = read_mps_show_info_header_fd(fd, &num_slides)))) {
+            printf("Error: Unable to read MPS file '%s'\n", files[f]);
+            if(fd >= 0) close(fd);
+            return -1;
+        }
+        for(int i = 0; i < num_slides; i++) {
+            if(0 != mps_ring_put_image_fd(ring, fd, &slide_info[i], i)) {
+                printf("Error: Unable to read image %d of '%s'\n", i + 1, files[f]);
+                free(slide_info);
+                close(fd);
+                return -1;
+            }
+            frames++;
+            if(delay_ms) nap_ms(delay_ms);
+        }
+        free(slide_info);
+        close(fd);
+    }
+    mps_ring_end(ring);
+
+    double secs = now() - t0;
+    printf("Produced %llu frames in %.3fs (%.1f frames/s)\n", (unsigned long long)frames, secs,
+        (secs > 0.0) ? frames / secs : 0.0);
+
+    // the consumer still needs the last frames, so wait for it to release them
+    if(ring->hdr->flags & MPS_RING_WAIT) {
+        while(atomic_load(&ring->hdr->tail) < frames) {
+            nap_ms(1);
+        }
+    }
+    return 0;
+}
+
+/// @brief reads the frames from the ring until the producer finishes
+/// @return 0 on success
+static int consume(mps_ring_t *ring, int timeout_ms, bool quiet) {
+    uint64_t frames = 0, lost = 0;
+    bool wait = (ring->hdr->flags & MPS_RING_WAIT);
+    double t0 = now();
+
+    // start from the oldest frame still in the ring
+    uint64_t head = mps_ring_head(ring);
+    uint64_t n = (head > ring->hdr->num_slots) ? head - ring->hdr->num_slots : 0;
+    lost = n;
+
+    for(;;) {
+        int state = mps_ring_wait(ring, n, timeout_ms);
+        if(MPS_RING_END == state) {
+            break;
+        }
+        if(MPS_RING_EMPTY == state) {
+            printf("Error: Timed out waiting for frame %llu\n", (unsigned long long)n);
+            return -1;
+        }
+
+        // the frame is used where it is, in the shared memory
+        const mps_ring_slot_t *slot = NULL;
+        uint32_t crc = 0;
+        if(MPS_RING_READY == (state = mps_ring_peek(ring, n, &slot))) {
+            crc = crc32c(crc32c(0, slot->pixels, MPS_RING_FRAMESZ), slot->pal, sizeof(slot->pal));
+            if(!quiet) {
+                printf("%llu\t%u\t%-8s\t%u\t%08x\n", (unsigned long long)n, slot->slide, slot->name,
+                    slot->len, crc);
+            }
+            state = mps_ring_check(ring, n);
+        }
+        if(MPS_RING_READY != state) {
+            // fell behind and the frame was overwritten, skip to the oldest one left
+            head = mps_ring_head(ring);
+            uint64_t next = (head > ring->hdr->num_slots) ? head - ring->hdr->num_slots : n + 1;
+            if(next <= n) next = n + 1;
+            lost += next - n;
+            n = next;
+            continue;
+        }
+        if(wait) {
+            mps_ring_release(ring, n);
+        }
+        frames++;
+        n++;
+    }
+
+    double secs = now() - t0;
+    printf("Consumed %llu frames, %llu lost, in %.3fs (%.1f MB/s)\n", (unsigned long long)frames,
+        (unsigned long long)lost, secs, (secs > 0.0) ? (frames * sizeof(mps_ring_slot_t)) / (secs * 1024 * 1024) : 0.0);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int rval = -1;
+    mps_ring_t *ring = NULL;
+    bool producer = false, consumer = false;
+    bool quiet = false;
+    uint32_t flags = 0;
+    int num_slots = MPS_RING_SLOTS;
+    int delay_ms = 0;
+    int timeout_ms = DEF_TIMEOUT;
+
+    printf("MPSshm - MPSShow Shared Memory Frame Ring\n");
+
+    char *prog = filename(argv[0]);
+    argv++; argc--; // consume the first arg (program name)
+
+    // parse any options
+    while((argc) && ('-' == argv[0][0])) {
+        if(0 == strcmp(argv[0], "-p")) {
+            producer = true;
+            argv++; argc--; // consume the option
+        } else if(0 == strcmp(argv[0], "-c")) {
+            consumer = true;
+            argv++; argc--; // consume the option
+        } else if(0 == strcmp(argv[0], "-w")) {
+            flags |= MPS_RING_WAIT;
+            argv++; argc--; // consume the option
+        } else if(0 == strcmp(argv[0], "-q")) {
+            quiet = true;
+            argv++; argc--; // consume the option
+        } else if((0 == strcmp(argv[0], "-n")) && (argc > 1)) {
+            num_slots = atoi(argv[1]);
+            argv += 2; argc -= 2; // consume the option and its value
+        } else if((0 == strcmp(argv[0], "-d")) && (argc > 1)) {
+            delay_ms = atoi(argv[1]);
+            argv += 2; argc -= 2; // consume the option and its value
+        } else if((0 == strcmp(argv[0], "-t")) && (argc > 1)) {
+            timeout_ms = atoi(argv[1]);
+            argv += 2; argc -= 2; // consume the option and its value
+        } else {
+            printf("ERROR: Unknown option '%s'\n", argv[0]);
+            argc = 0; // force the usage message
+        }
+    }
+
+    if((producer == consumer) || (argc < 1) || (producer && (argc < 2)) || (consumer && (argc > 1)) ||
+       (num_slots < 1) || (delay_ms < 0)) {
+        printf("USAGE: %s -p <options> [ring] [infile...]\n", prog);
+        printf("       %s -c <options> [ring]\n", prog);
+        printf("[ring] is the name of the shared memory ring, e.g. /mps-ring\n");
+        printf("[infile...] are the MPS files to decode into the ring\n");
+        printf("<options>\n");
+        printf("  -p           create the ring and decode the slides into it\n");
+        printf("  -c           read the frames from the ring, listing each one\n");
+        printf("  -n [slots]   number of frame slots in the ring (default %d)\n", MPS_RING_SLOTS);
+        printf("  -w           the producer waits for the consumer, rather than overwrite frames\n");
+        printf("  -d [ms]      time the producer waits between frames\n");
+        printf("  -t [ms]      time the consumer waits for the ring and for each frame (default %d)\n", DEF_TIMEOUT);
+        printf("  -q           the consumer only reports the totals\n");
+        return -1;
+    }
+
+    if(producer) {
+        if(NULL == (ring = mps_ring_create(argv[0], num_slots, flags))) {
+            printf("Error: Unable to create ring '%s'\n", argv[0]);
+            goto CLEANUP;
+        }
+        printf("Created ring '%s' with %d slots of %zu bytes\n", argv[0], num_slots, sizeof(mps_ring_slot_t));
+        if(0 != produce(ring, &argv[1], argc - 1, delay_ms)) {
+            goto CLEANUP;
+        }
+    } else {
+        // the producer may not have started yet
+        for(int waited = 0; NULL == (ring = mps_ring_open(argv[0])); waited += POLL_MS) {
+            if(waited >= timeout_ms) {
+                printf("Error: Unable to open ring '%s'\n", argv[0]);
+                goto CLEANUP;
+            }
+            nap_ms(POLL_MS);
+        }
+        if(0 != consume(ring, timeout_ms, quiet)) {
+            goto CLEANUP;
+        }
+    }
+
+    rval = 0; // clean exit
+
+CLEANUP:
+    mps_ring_close(ring);
+    return rval;
+}
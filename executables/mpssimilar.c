@@ -0,0 +1,241 @@
+/*
+ * MPSsimilar.c
+ * Finds slides that look alike across a set of MPSShow data files (.MPS), even when they
+ * are not byte for byte duplicates, such as slides that have been re-encoded, had their
+ * palette shifted, or have had small edits made.
+ *
+ * A perceptual hash is computed for every slide, and the hashes are put in a multi-index
+ * hash so that all the slides within a given Hamming distance of a slide can be found
+ * without comparing every pair of slides.
+ *
+ * To obtain the .MPS file you can use 'MPSextract' on a MPSShow slideshow demo exe file
+ *
+ * This code is offered without warranty under the MIT License. Use it as you will
+ * personally or commercially, just give credit if you do.
+ */
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "util.h"
+#include "mps-show.h"
+#include "mps-phash.h"
+#include "mihash.h"
+#include "parallel.h"
+
+#define DEF_RADIUS (8)    // default maximum Hamming distance for slides to be similar
+
+// a single slide in the index
+typedef struct {
+    uint64_t    hash;
+    int         file;       // index of the file the slide is in
+    int         slide;      // 0 based index of the slide within the file
+    bool        valid;      // the hash was computed
+    uint8_t     name_len;
+    char        name[9];    // the slide's name, kept for the report once its info is freed
+} entry_t;
+
+typedef struct {
+    const char  *name;
+    int         error;
+    int         num_slides;
+    info_t      *slide_info; // the file's info block, freed once its slides are hashed
+    size_t      first;      // index of the file's first slide in the entry list
+} file_t;
+
+typedef struct {
+    file_t      *files;
+    entry_t     *entries;
+} hash_ctx_t;
+
+// state for reporting the matches for one slide
+typedef struct {
+    hash_ctx_t  *hc;
+    size_t      query;      // entry being queried
+    bool        pairs;      // only report each pair once
+    size_t      matches;
+} match_ctx_t;
+
+/// @brief hashes all the slides of a single file, called from the thread pool
+static void hash_file(void *ctx, size_t index, int thread) {
+    (void)thread;
+    hash_ctx_t *hc = ctx;
+    file_t *f = &hc->files[index];
+    memstream_buf_t src = {0, 0, NULL};
+    int fd = -1;
+
+    fd = open(f->name, O_RDONLY);
+    for(int i = 0; i < f->num_slides; i++) {
+        entry_t *e = &hc->entries[f->first + i];
+        info_t *si = &f->slide_info[i];
+        e->file = index;
+        e->slide = i;
+        e->name_len = (si->name_len < sizeof(e->name)) ? si->name_len : sizeof(e->name);
+        memcpy(e->name, si->name, e->name_len);
+        if((fd < 0) || (0 != read_mps_show_rle_fd(&src, fd, si))) {
+            continue;
+        }
+        e->valid = (0 == mps_phash(&e->hash, &src, si->pal));
+        free_s(src.data);
+    }
+    if(fd >= 0) close(fd);
+    free_s(f->slide_info); // only the names are needed from here on
+}
+
+static void print_slide(hash_ctx_t *hc, size_t id) {
+    entry_t *e = &hc->entries[id];
+    printf("%s:%d %-9.*s", hc->files[e->file].name, e->slide + 1, e->name_len, e->name);
+}
+
+/// @brief called for each match found in the index
+static void on_match(void *ctx, size_t id, int dist) {
+    match_ctx_t *mc = ctx;
+    if(id == mc->query) {
+        return; // the slide itself
+    }
+    if((mc->pairs) && (id < mc->query)) {
+        return; // already reported when the other slide was queried
+    }
+    printf("  ");
+    print_slide(mc->hc, mc->query);
+    printf("  ~  ");
+    print_slide(mc->hc, id);
+    printf("  dist:%d\n", dist);
+    mc->matches++;
+}
+
+int main(int argc, char *argv[]) {
+    int rval = -1;
+    int radius = DEF_RADIUS;
+    int threads = 0;
+    char *query = NULL;
+    hash_ctx_t hc = {NULL, NULL};
+    mihash_t index;
+    size_t num_entries = 0;
+
+    printf("MPSsimilar - MPSShow Similar Slide Finder\n");
+
+    char *prog = filename(argv[0]);
+    argv++; argc--; // consume the first arg (program name)
+
+    // parse any options, these come before the positional args
+    while((argc) && ('-' == argv[0][0])) {
+        if((0 == strcmp(argv[0], "-r")) && (argc > 1)) {
+            radius = atoi(argv[1]);
+            argv += 2; argc -= 2; // consume the option and its value
+        } else if((0 == strcmp(argv[0], "-q")) && (argc > 1)) {
+            query = argv[1];
+            argv += 2; argc -= 2; // consume the option and its value
+        } else if((0 == strcmp(argv[0], "-t")) && (argc > 1)) {
+            threads = atoi(argv[1]);
+            argv += 2; argc -= 2; // consume the option and its value
+        } else {
+            printf("ERROR: Unknown option '%s'\n", argv[0]);
+            argc = 0; // force the usage message
+        }
+    }
+
+    if((argc < 1) || (radius < 0) || (radius > 64)) {
+        printf("USAGE: %s <options> [infile] <infile...>\n", prog);
+        printf("[infile] is the name of an MPS file to index, any number may be given\n");
+        printf("if no query is given, all groups of similar slides are listed\n");
+        printf("<options>\n");
+        printf("  -q [file:slide]  list only the slides similar to the given slide, e.g. 'DEMO.MPS:3'\n");
+        printf("  -r [distance]    maximum number of hash bits that may differ (0-64, default %d)\n", DEF_RADIUS);
+        printf("  -t [count]       number of threads to hash with (default is one per processor)\n");
+        return -1;
+    }
+
+    mihash_init(&index, radius);
+
+    // read all the info blocks, to size the index
+    if(NULL == (hc.files = calloc(argc, sizeof(file_t)))) {
+        printf("Unable to allocate memory\n");
+        goto CLEANUP;
+    }
+    for(int i = 0; i < argc; i++) {
+        file_t *f = &hc.files[i];
+        f->name = argv[i];
+        f->first = num_entries;
+        int fd = open(f->name, O_RDONLY);
+        if((fd < 0) || (NULL == (f->slide_info = read_mps_show_info_header_fd(fd, &f->num_slides)))) {
+            printf("Error: Unable to read '%s'\n", f->name);
+            f->error = -1;
+            f->num_slides = 0;
+        }
+        if(fd >= 0) close(fd);
+        num_entries += f->num_slides;
+    }
+    if(NULL == (hc.entries = calloc(num_entries + 1, sizeof(entry_t)))) {
+        printf("Unable to allocate memory\n");
+        goto CLEANUP;
+    }
+
+    // hash all the slides in parallel, then build the index
+    if(0 != parallel_for(argc, threads, hash_file, &hc)) {
+        printf("Error: Unable to start threads\n");
+        goto CLEANUP;
+    }
+    size_t num_indexed = 0;
+    for(size_t i = 0; i < num_entries; i++) {
+        if(!hc.entries[i].valid) {
+            continue;
+        }
+        if(0 != mihash_add(&index, hc.entries[i].hash, i)) {
+            printf("Unable to allocate memory\n");
+            goto CLEANUP;
+        }
+        num_indexed++;
+    }
+    if(0 != mihash_build(&index)) {
+        printf("Unable to allocate memory\n");
+        goto CLEANUP;
+    }
+    printf("Indexed %zu slides from %d files, radius: %d\n", num_indexed, argc, radius);
+
+    match_ctx_t mc = {&hc, 0, false, 0};
+    if(query) {
+        // find the slide named in the query
+        char *sep = strrchr(query, ':');
+        int slide = (sep) ? atoi(sep + 1) : 0;
+        size_t qlen = (sep) ? (size_t)(sep - query) : strlen(query);
+        size_t id = num_entries;
+        for(int i = 0; (i < argc) && (id == num_entries); i++) {
+            file_t *f = &hc.files[i];
+            if((strlen(f->name) == qlen) && (0 == strncmp(f->name, query, qlen)) && (slide >= 1) && (slide <= f->num_slides)) {
+                id = f->first + slide - 1;
+            }
+        }
+        if((id == num_entries) || (!hc.entries[id].valid)) {
+            printf("ERROR: Query slide '%s' not found\n", query);
+            goto CLEANUP;
+        }
+        mc.query = id;
+        mihash_query(&index, hc.entries[id].hash, on_match, &mc);
+    } else {
+        // report every similar pair once
+        mc.pairs = true;
+        for(size_t i = 0; i < num_entries; i++) {
+            if(!hc.entries[i].valid) continue;
+            mc.query = i;
+            mihash_query(&index, hc.entries[i].hash, on_match, &mc);
+        }
+    }
+    printf("Found %zu similar slide%s\n", mc.matches, (query) ? "s" : " pairs");
+    rval = 0; // clean exit
+
+CLEANUP:
+    mihash_free(&index);
+    if(hc.files) {
+        for(int i = 0; i < argc; i++) {
+            free_s(hc.files[i].slide_info);
+        }
+    }
+    free_s(hc.files);
+    free_s(hc.entries);
+    return rval;
+}
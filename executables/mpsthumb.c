@@ -0,0 +1,154 @@
+/*
+ * MPSthumb.c 
+ * Parses the given MPSShow data file (.MPS) and generates small truecolour thumbnails
+ * of the slides. The images are downscaled while being decoded, so the full size image
+ * is never created.
+ * 
+ * To obtain the .MPS file you can use 'MPSextract' on a MPSShow slideshow demo exe file
+ * 
+ * This code is offered without warranty under the MIT License. Use it as you will 
+ * personally or commercially, just give credit if you do.
+ */
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "util.h"
+#include "mps-show.h"
+#include "mps-thumb.h"
+#include "bmp.h"
+
+#define OUTEXT   ".BMP"   // default extension for the output file
+#define OUTNAMESZ (32)    // size of buffer for generated output names
+
+int main(int argc, char *argv[]) {
+    int rval = -1;
+    FILE *fi = NULL;
+    char *fi_name = NULL;
+    char *fo_name = NULL;
+    int scale = 0;
+    int xtridx  = 0;
+    info_t *slide_info = NULL;
+    memstream_buf_t img = {0, 0, NULL};
+
+    printf("MPSthumb - MPSShow Thumbnail Generator\n");
+
+    if((argc < 3) || (argc > 5)) {
+        printf("USAGE: %s [infile] [scale] <extract> <outfile>\n", filename(argv[0]));
+        printf("[infile] is the name of the input MPS file to generate thumbnails from\n");
+        printf("[scale] is the downscale factor, one of 2, 4, or 8\n");
+        printf("<extract> is the optional numerical index of the slide to generate a thumbnail for\n");
+        printf("if <extract> is omitted or 0, thumbnails for all slides will be generated.\n");
+        printf("<outfile> optinal name for the output file, ignored if <extract> is 0\n");
+        return -1;
+    }
+    argv++; argc--; // consume the first arg (program name)
+
+    // get the file names from the command line
+    int namelen = strlen(argv[0]);
+    if(NULL == (fi_name = calloc(1, namelen+1))) {
+        printf("Unable to allocate memory\n");
+        goto CLEANUP;
+    }
+    strncpy(fi_name, argv[0], namelen);
+    argv++; argc--; // consume the arg (input file)
+
+    // get the downscale factor
+    sscanf(argv[0],"%d",&scale);
+    argv++; argc--; // consume the arg (scale)
+    if(!thumb_scale_valid(scale)) {
+        printf("ERROR: Invalid scale '%d', must be 2, 4, or 8\n", scale);
+        goto CLEANUP;
+    }
+
+    // get the index of the slide to generate, if given
+    if(argc) {
+        sscanf(argv[0],"%u",&xtridx);
+        argv++; argc--; // consume the arg (extract index)
+    }
+
+    // get the optional output filename, if generating a single thumbnail
+    if((argc) && (xtridx > 0)) {
+        namelen = strlen(argv[0]);
+        if(NULL == (fo_name = calloc(1, namelen+1))) {
+            printf("Unable to allocate memory\n");
+            goto CLEANUP;
+        }
+        strncpy(fo_name, argv[0], namelen);
+    }
+
+    // open the input file
+    printf("Opening MPS File: '%s'", fi_name);
+    if(NULL == (fi = fopen(fi_name,"rb"))) {
+        printf("Error: Unable to open input file\n");
+        goto CLEANUP;
+    }
+
+    // determine size of the MPS file
+    size_t fsz = filesize(fi);
+    printf("\tFile Size: %zu\n", fsz);
+
+    // read in the mpsshow information block
+    int num_slides = -1;
+    if(NULL == (slide_info = read_mps_show_info_header(fi, &num_slides))) {
+        printf("Error reading MPSShow info block\n");
+        goto CLEANUP;
+    }
+    printf("Number of slides: %d\n", num_slides);
+    if((xtridx < 0) || (xtridx > num_slides)) {
+        printf("ERROR: Extract index '%d' out of range\n", xtridx);
+        goto CLEANUP;
+    }
+
+    // allocate the thumbnail buffer
+    int tw = MPS_WIDTH / scale;
+    int th = MPS_HEIGHT / scale;
+    img.len = thumb_size(scale);
+    if(NULL == (img.data = calloc(1, img.len))) {
+        printf("Unable to allocate memory\n");
+        goto CLEANUP;
+    }
+
+    // create the output filename buffer, if not given
+    if(NULL == fo_name) {
+        if(NULL == (fo_name = calloc(1, OUTNAMESZ))) {
+            printf("Unable to allocate memory\n");
+            goto CLEANUP;
+        }
+    }
+
+    // generate all the thumbnails, or just the one requested
+    int first = (0 == xtridx) ? 0 : xtridx - 1;
+    int last = (0 == xtridx) ? num_slides : xtridx;
+    for(int i = first; i < last; i++) {
+        if((0 == xtridx) || (0 == argc)) {
+            // create the output filename based on the name in the slide
+            snprintf(fo_name, OUTNAMESZ, "%.*s-T%d%s", slide_info[i].name_len, slide_info[i].name, scale, OUTEXT);
+        }
+        printf("Saving: '%s' (%dx%d)\n", fo_name, tw, th);
+
+        // read in the image as a thumbnail
+        img.pos = 0;
+        if(0 != read_mps_show_thumbnail(&img, fi, &slide_info[i], scale)) {
+            printf("Error: Unable to read image\n");
+            goto CLEANUP;
+        }
+
+        if(0 != save_bmp24(fo_name, &img, tw, th)) {
+            printf("Error: Unable to save BMP image\n");
+            goto CLEANUP;
+        }
+    }
+
+    rval = 0; // clean exit
+
+CLEANUP:
+    fclose_s(fi);
+    free_s(img.data);
+    free_s(slide_info);
+    free_s(fi_name);
+    free_s(fo_name);
+    return rval;
+}
@@ -0,0 +1,321 @@
+/*
+ * MPSverify.c
+ * Checks a set of MPSShow data files (.MPS) for truncation and corruption. For every
+ * file the info block and every slide's image data must lie within the file, and every
+ * image must decode to exactly one full frame. A CRC-32C is computed for each file and
+ * each slide's compressed data, these can be saved to a manifest, and later files can be
+ * compared against a manifest to find any that have changed. The manifest is the same
+ * one MPSexplore uses, each file is an input and each of its slides an output, named
+ * by the slide's number.
+ *
+ * Files are checked in parallel, and the CRC uses the CPU's CRC instructions when
+ * available, so checking is limited by the speed the files can be read.
+ *
+ * To obtain the .MPS file you can use 'MPSextract' on a MPSShow slideshow demo exe file
+ *
+ * This code is offered without warranty under the MIT License. Use it as you will
+ * personally or commercially, just give credit if you do.
+ */
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "util.h"
+#include "mps-show.h"
+#include "crc32c.h"
+#include "manifest.h"
+#include "parallel.h"
+
+#define IMAGE_WIDTH (320)
+#define IMAGE_HEIGHT (200)
+#define IMAGE_SIZE (IMAGE_WIDTH * IMAGE_HEIGHT)
+#define MSGSZ (128)
+
+// results of checking a single file
+typedef struct {
+    const char  *name;
+    bool        ok;             // passed all checks
+    char        msg[MSGSZ];     // reason for failure
+    size_t      size;           // size of the file
+    uint32_t    crc;            // CRC of the whole file
+    int         num_slides;
+    uint32_t    *slide_crc;     // CRC of each slide's compressed data
+    uint32_t    *slide_len;     // length of each slide's compressed data
+} result_t;
+
+/// @brief reads exactly 'len' bytes at 'offset'
+/// @return 0 on success
+static int pread_all(int fd, uint8_t *buf, size_t len, off_t offset) {
+    while(len) {
+        ssize_t nr = pread(fd, buf, len, offset);
+        if((nr < 0) && (EINTR == errno)) {
+            continue; // interrupted by a signal before anything was read
+        }
+        if(nr <= 0) {
+            return -1;
+        }
+        buf += nr;
+        len -= nr;
+        offset += nr;
+    }
+    return 0;
+}
+
+/// @brief checks a single file, called from the thread pool
+static void verify_file(void *ctx, size_t index, int thread) {
+    (void)thread;
+    result_t *res = &((result_t *)ctx)[index];
+    uint8_t *data = NULL;
+    uint8_t *img = NULL;
+    int fd = -1;
+    struct stat st;
+
+    res->ok = false;
+    if(((fd = open(res->name, O_RDONLY)) < 0) || (0 != fstat(fd, &st))) {
+        snprintf(res->msg, MSGSZ, "unable to open file");
+        goto cleanup;
+    }
+    res->size = st.st_size;
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    // the whole file is read in one go, one spare byte lets the decoder safely read
+    // past the end of an odd length stream in the last slide
+    if((NULL == (data = calloc(1, res->size + 1))) || (NULL == (img = malloc(IMAGE_SIZE)))) {
+        snprintf(res->msg, MSGSZ, "out of memory");
+        goto cleanup;
+    }
+    if(0 != pread_all(fd, data, res->size, 0)) {
+        snprintf(res->msg, MSGSZ, "read error");
+        goto cleanup;
+    }
+    res->crc = crc32c(0, data, res->size);
+
+    // the info block
+    if((res->size < 1) || (0 == data[0])) {
+        snprintf(res->msg, MSGSZ, "no slides");
+        goto cleanup;
+    }
+    res->num_slides = data[0];
+    size_t hdr_sz = 1 + (size_t)res->num_slides * MPSRECSZ;
+    if(hdr_sz > res->size) {
+        snprintf(res->msg, MSGSZ, "info block truncated, %d slides need %zu bytes", res->num_slides, hdr_sz);
+        goto cleanup;
+    }
+    if((NULL == (res->slide_crc = calloc(res->num_slides, sizeof(uint32_t)))) ||
+       (NULL == (res->slide_len = calloc(res->num_slides, sizeof(uint32_t))))) {
+        snprintf(res->msg, MSGSZ, "out of memory");
+        goto cleanup;
+    }
+
+    // every slide must lie within the file, and decode to a full frame
+    info_t *slide_info = (info_t *)&data[1];
+    for(int i = 0; i < res->num_slides; i++) {
+        info_t *si = &slide_info[i];
+        if(((uint64_t)si->img_offset + si->img_len) > res->size) {
+            snprintf(res->msg, MSGSZ, "slide %d: image data (ofs:%u len:%u) past end of file", i + 1, si->img_offset, si->img_len);
+            goto cleanup;
+        }
+        if(si->img_offset < hdr_sz) {
+            snprintf(res->msg, MSGSZ, "slide %d: image data (ofs:%u) overlaps info block", i + 1, si->img_offset);
+            goto cleanup;
+        }
+        res->slide_crc[i] = crc32c(0, &data[si->img_offset], si->img_len);
+        res->slide_len[i] = si->img_len;
+
+        memstream_buf_t src = {si->img_len, 0, &data[si->img_offset]};
+        memstream_buf_t dst = {IMAGE_SIZE, 0, img};
+        if(0 != rle_decompress(&dst, &src)) {
+            snprintf(res->msg, MSGSZ, "slide %d: image decodes to more than %d bytes", i + 1, IMAGE_SIZE);
+            goto cleanup;
+        }
+        if(IMAGE_SIZE != dst.pos) {
+            snprintf(res->msg, MSGSZ, "slide %d: image decodes to %zu of %d bytes", i + 1, dst.pos, IMAGE_SIZE);
+            goto cleanup;
+        }
+    }
+    res->ok = true;
+
+cleanup:
+    if(fd >= 0) close(fd);
+    free_s(data);
+    free_s(img);
+}
+
+/// @brief finds the record of a slide, by its number, among a file's outputs
+static const manifest_entry_t *find_slide(const manifest_input_t *in, int slide) {
+    char name[16];
+    snprintf(name, sizeof(name), "%d", slide);
+    return manifest_output(in, name);
+}
+
+/// @brief records the results for all good files in a manifest, replacing any earlier
+/// records for the same files
+static int write_manifest(const char *fn, result_t *res, int count) {
+    manifest_t man;
+    if(0 != manifest_open(&man, fn)) {
+        return -1;
+    }
+    int err = 0;
+    for(int i = 0; (0 == err) && (i < count); i++) {
+        if(!res[i].ok) continue;
+        manifest_entry_t in = {(char *)res[i].name, 0, 0, 0};
+        err = manifest_stat(&in);
+        in.size = res[i].size;  // as checked, should the file have changed since
+        in.crc = res[i].crc;
+        if(0 == err) {
+            err = manifest_set_input(&man, &in, false);
+        }
+        char name[16];
+        for(int j = 0; (0 == err) && (j < res[i].num_slides); j++) {
+            snprintf(name, sizeof(name), "%d", j + 1);
+            manifest_entry_t out = {name, res[i].slide_len[j], 0, res[i].slide_crc[j]};
+            err = manifest_add(&man, &out);
+        }
+    }
+    if(0 != manifest_close(&man)) {
+        err = -1;
+    }
+    return err;
+}
+
+/// @brief compares a file's results with its manifest record
+static void check_manifest(result_t *res, const manifest_t *man) {
+    const manifest_input_t *m = manifest_input(man, res->name);
+    if(NULL == m) {
+        res->ok = false;
+        snprintf(res->msg, MSGSZ, "not in manifest");
+        return;
+    }
+    if((m->input.crc == res->crc) && (m->input.size == res->size)) {
+        return; // unchanged
+    }
+    res->ok = false;
+    if(m->input.size != res->size) {
+        snprintf(res->msg, MSGSZ, "size %zu does not match manifest %llu", res->size, (unsigned long long)m->input.size);
+    } else {
+        snprintf(res->msg, MSGSZ, "crc %08x does not match manifest %08x", res->crc, m->input.crc);
+    }
+    // narrow it down to the slides that changed
+    if(m->num_outputs != res->num_slides) {
+        size_t n = strlen(res->msg);
+        snprintf(&res->msg[n], MSGSZ - n, ", %d slides, manifest has %d", res->num_slides, m->num_outputs);
+        return;
+    }
+    for(int i = 0; i < res->num_slides; i++) {
+        const manifest_entry_t *rec = find_slide(m, i + 1);
+        if((NULL == rec) || (rec->crc != res->slide_crc[i]) || (rec->size != res->slide_len[i])) {
+            size_t n = strlen(res->msg);
+            snprintf(&res->msg[n], MSGSZ - n, ", slide %d changed", i + 1);
+            break;
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int rval = -1;
+    int threads = 0;
+    bool quiet = false;
+    char *man_in = NULL;
+    char *man_out = NULL;
+    result_t *res = NULL;
+    manifest_t man;
+    bool man_read = false;
+
+    printf("MPSverify - MPSShow Data Integrity Checker\n");
+
+    char *prog = filename(argv[0]);
+    argv++; argc--; // consume the first arg (program name)
+
+    // parse any options, these come before the positional args
+    while((argc) && ('-' == argv[0][0])) {
+        if((0 == strcmp(argv[0], "-m")) && (argc > 1)) {
+            man_in = argv[1];
+            argv += 2; argc -= 2; // consume the option and its value
+        } else if((0 == strcmp(argv[0], "-w")) && (argc > 1)) {
+            man_out = argv[1];
+            argv += 2; argc -= 2; // consume the option and its value
+        } else if((0 == strcmp(argv[0], "-t")) && (argc > 1)) {
+            threads = atoi(argv[1]);
+            argv += 2; argc -= 2; // consume the option and its value
+        } else if(0 == strcmp(argv[0], "-q")) {
+            quiet = true;
+            argv++; argc--; // consume the option
+        } else {
+            printf("ERROR: Unknown option '%s'\n", argv[0]);
+            argc = 0; // force the usage message
+        }
+    }
+
+    if(argc < 1) {
+        printf("USAGE: %s <options> [infile] <infile...>\n", prog);
+        printf("[infile] is the name of an MPS file to check, any number may be given\n");
+        printf("<options>\n");
+        printf("  -m [file]   compare the files against the CRCs stored in a manifest\n");
+        printf("  -w [file]   record the CRCs of all the good files in a manifest\n");
+        printf("  -t [count]  number of threads to use (default is one per processor)\n");
+        printf("  -q          only report files with problems\n");
+        return -1;
+    }
+
+    if(man_in) {
+        if(0 != manifest_read(&man, man_in)) {
+            printf("Error: Unable to read manifest '%s'\n", man_in);
+            goto CLEANUP;
+        }
+        man_read = true;
+    }
+
+    if(NULL == (res = calloc(argc, sizeof(result_t)))) {
+        printf("Unable to allocate memory\n");
+        goto CLEANUP;
+    }
+    for(int i = 0; i < argc; i++) {
+        res[i].name = argv[i];
+    }
+    printf("Checking %d files, CRC-32C: %s\n", argc, crc32c_impl());
+    if(0 != parallel_for(argc, threads, verify_file, res)) {
+        printf("Error: Unable to start threads\n");
+        goto CLEANUP;
+    }
+
+    if((man_out) && (0 != write_manifest(man_out, res, argc))) {
+        printf("Error: Unable to write manifest '%s'\n", man_out);
+        goto CLEANUP;
+    }
+
+    int num_bad = 0;
+    for(int i = 0; i < argc; i++) {
+        if((res[i].ok) && (man_read)) {
+            check_manifest(&res[i], &man);
+        }
+        if(!res[i].ok) {
+            num_bad++;
+            printf("FAIL %s: %s\n", res[i].name, res[i].msg);
+        } else if(!quiet) {
+            printf("OK   %s (%d slides, crc:%08x)\n", res[i].name, res[i].num_slides, res[i].crc);
+        }
+    }
+    printf("%d of %d files OK\n", argc - num_bad, argc);
+    rval = (num_bad) ? 1 : 0;
+
+CLEANUP:
+    if(res) {
+        for(int i = 0; i < argc; i++) {
+            free_s(res[i].slide_crc);
+            free_s(res[i].slide_len);
+        }
+    }
+    free_s(res);
+    if(man_read) {
+        manifest_close(&man);
+    }
+    return rval;
+}
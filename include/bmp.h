@@ -1,11 +1,12 @@
 /*
  * bmp.h 
- * interface definitions for a writing an indexed 256 colour Windows BMP file
+ * interface definitions for a writing an indexed 256 colour, or truecolour Windows BMP file
  * 
  * This code is offered without warranty under the MIT License. Use it as you will 
  * personally or commercially, just give credit if you do.
  */
 #include <stdint.h>
+#include <stddef.h>
 #include "memstream.h"
 #include "pal.h"
 
@@ -21,4 +22,27 @@
 /// @return 0 on success, otherwise an error code
 int save_bmp(const char *fn, memstream_buf_t *src, uint16_t width, uint16_t height, pal_entry_t *xpal);
 
+/// @brief determines the size of the file produced for an indexed 256 colour BMP
+/// @param width  width of the image in pixels
+/// @param height height of the image in pixels or lines
+/// @return size of the complete BMP file in bytes
+size_t bmp_size(uint16_t width, uint16_t height);
+
+/// @brief encodes the image pointed to by src as a BMP in memory, as save_bmp() would write it to a file
+/// @param dst memstream buffer to hold the BMP file data, needs room for bmp_size() bytes
+/// @param src memstream buffer pointer to the source image data
+/// @param width  width of the image in pixels
+/// @param height height of the image in pixels or lines
+/// @param pal pointer to 256 entry RGB palette
+/// @return 0 on success, otherwise an error code
+int encode_bmp(memstream_buf_t *dst, memstream_buf_t *src, uint16_t width, uint16_t height, pal_entry_t *xpal);
+
+/// @brief saves the image pointed to by src as a 24 bit truecolour BMP, assumes 3 byte per pixel RGB image data
+/// @param fn name of the file to create and write to
+/// @param src memstream buffer pointer to the source image data
+/// @param width  width of the image in pixels
+/// @param height height of the image in pixels or lines
+/// @return 0 on success, otherwise an error code
+int save_bmp24(const char *fn, memstream_buf_t *src, uint16_t width, uint16_t height);
+
 #endif
@@ -0,0 +1,25 @@
+/*
+ * crc32c.h 
+ * CRC-32C (Castagnoli) checksums, using the CPU's CRC instructions when available
+ * 
+ * This code is offered without warranty under the MIT License. Use it as you will 
+ * personally or commercially, just give credit if you do.
+ */
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef CA_CRC32C
+#define CA_CRC32C
+
+/// @brief updates a running CRC-32C with more data, start with a crc of 0
+/// @param crc the CRC of the data so far, 0 to start
+/// @param data pointer to the data
+/// @param len length of the data in bytes
+/// @return the updated CRC
+uint32_t crc32c(uint32_t crc, const void *data, size_t len);
+
+/// @brief reports how the CRC is being computed
+/// @return a short name for the implementation in use, e.g. "sse4.2"
+const char *crc32c_impl(void);
+
+#endif
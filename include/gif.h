@@ -0,0 +1,50 @@
+/*
+ * gif.h
+ * interface definitions for writing an animated GIF89a image as a single sequential stream
+ *
+ * Every frame carries its own local colour table, so frames with different palettes can
+ * follow each other, and a frame need only cover the part of the image that has changed.
+ *
+ * This code is offered without warranty under the MIT License. Use it as you will
+ * personally or commercially, just give credit if you do.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include "pal.h"
+
+#ifndef CA_GIF
+#define CA_GIF
+
+#define GIF_LOOP_NONE (-1)  // no looping extension, the animation plays once
+
+/// @brief writes the GIF header and logical screen descriptor, without a global colour
+/// table, followed by the NETSCAPE2.0 looping extension
+/// @param fp the open output stream
+/// @param width width of the image in pixels
+/// @param height height of the image in pixels
+/// @param loops number of times to repeat the animation, 0 for forever, or GIF_LOOP_NONE
+/// @return 0 on success
+int gif_write_header(FILE *fp, int width, int height, int loops);
+
+/// @brief writes one frame, the graphic control extension, image descriptor, local colour
+/// table, and the LZW compressed pixels of a rectangle of the image. The frame is drawn
+/// over the previous frames, so the pixels outside the rectangle are kept.
+/// @param fp the open output stream
+/// @param pixels pointer to the top left pixel of the whole image, one byte per pixel
+/// @param stride width of the whole image in pixels
+/// @param x left edge of the rectangle to write
+/// @param y top edge of the rectangle to write
+/// @param w width of the rectangle
+/// @param h height of the rectangle
+/// @param pal pointer to the 256 entry palette of the frame (0-255 per component)
+/// @param delay time to show the frame for, in 1/100ths of a second
+/// @return 0 on success
+int gif_write_frame(FILE *fp, const uint8_t *pixels, int stride, int x, int y, int w, int h,
+                    const pal_entry_t *pal, int delay);
+
+/// @brief writes the GIF trailer, ending the image
+/// @param fp the open output stream
+/// @return 0 on success
+int gif_write_end(FILE *fp);
+
+#endif
@@ -0,0 +1,133 @@
+/*
+ * manifest.h
+ * a record of the files produced from a set of input files, for incremental and
+ * resumable runs, and for checking files have not changed
+ *
+ * The manifest is a text file of 'I' lines for the inputs, each followed by an 'O' line
+ * for each of that input's outputs. Each line gives the file's size, modification time
+ * and CRC-32C, then its name. One manifest can be shared by any number of inputs, the
+ * outputs are kept separately for each one. An output need not be a file, it can be a
+ * part of the input, e.g. the slides of a .MPS file.
+ *
+ * New records are appended and flushed as each output is written, so a run that is
+ * interrupted leaves a manifest of everything it finished, and a line it was part way
+ * through writing is removed when the manifest is next opened. Records later in the file
+ * replace earlier ones, and an 'I' line drops the outputs recorded before it for that
+ * input. If any records were replaced, the manifest is rewritten without them when it is
+ * closed. The records are kept in hash tables by name, so each is found in constant time.
+ *
+ * This code is offered without warranty under the MIT License. Use it as you will
+ * personally or commercially, just give credit if you do.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+#ifndef CA_MANIFEST
+#define CA_MANIFEST
+
+// identity of a file in the manifest
+typedef struct {
+    char        *name;
+    uint64_t    size;
+    int64_t     mtime;      // modification time, nanoseconds since the epoch
+    uint32_t    crc;        // CRC-32C of the file contents
+} manifest_entry_t;
+
+// an open addressed hash table of the records in a list, by name
+typedef struct {
+    int         *slots;     // index of the record in each slot plus 1, 0 if empty
+    int         size;       // number of slots, a power of 2, kept at least twice the records
+} manifest_index_t;
+
+// an input file, and the outputs made from it
+typedef struct {
+    manifest_entry_t    input;
+    manifest_entry_t    *outputs;
+    int                 num_outputs;
+    int                 max_outputs;
+    manifest_index_t    index;      // the outputs by name
+} manifest_input_t;
+
+typedef struct {
+    char                *fn;        // name of the manifest file
+    FILE                *fp;        // manifest, open for appending, NULL if only read
+    manifest_input_t    *inputs;
+    int                 num_inputs;
+    int                 max_inputs;
+    manifest_index_t    index;      // the inputs by name
+    int                 cur;        // the input being recorded, -1 for none
+    int                 last;       // the input of the last 'I' line in the file, -1 for none
+    bool                changed;    // the file has records that were replaced
+} manifest_t;
+
+/// @brief loads a manifest, and opens it for adding records, it is created if it does not exist
+/// @param man pointer to the manifest to initialize
+/// @param fn name of the manifest file
+/// @return 0 on success
+int manifest_open(manifest_t *man, const char *fn);
+
+/// @brief loads a manifest, only to look up records, the file must exist
+/// @param man pointer to the manifest to initialize
+/// @param fn name of the manifest file
+/// @return 0 on success
+int manifest_read(manifest_t *man, const char *fn);
+
+/// @brief writes out the manifest without any replaced records, if it was opened for
+/// adding records and any were replaced, and releases it
+/// @param man pointer to the manifest
+/// @return 0 on success
+int manifest_close(manifest_t *man);
+
+/// @brief fills in the size and modification time of a file
+/// @param e pointer to the entry to fill in, its name must be set
+/// @return 0 on success, -1 if the file does not exist
+int manifest_stat(manifest_entry_t *e);
+
+/// @brief computes the CRC-32C of a whole file
+/// @param name name of the file
+/// @param crc pointer to hold the CRC
+/// @return 0 on success
+int manifest_hash(const char *name, uint32_t *crc);
+
+/// @brief finds the record for an input file
+/// @param man pointer to the manifest
+/// @param name name of the input file
+/// @return pointer to the record, NULL if there is none
+const manifest_input_t *manifest_input(const manifest_t *man, const char *name);
+
+/// @brief finds the record for an output of an input file
+/// @param in pointer to the input's record
+/// @param name name of the output file
+/// @return pointer to the record, NULL if there is none
+const manifest_entry_t *manifest_output(const manifest_input_t *in, const char *name);
+
+/// @brief records an input file, and makes it the input that outputs are recorded for,
+/// nothing is written if the input is unchanged and its outputs are kept
+/// @param man pointer to the manifest
+/// @param input the identity of the input file
+/// @param keep true if the outputs recorded for the input are still valid
+/// @return 0 on success
+int manifest_set_input(manifest_t *man, const manifest_entry_t *input, bool keep);
+
+/// @brief records an output of the current input, replacing any previous record with the same name
+/// @param man pointer to the manifest
+/// @param output the identity of the output file
+/// @return 0 on success
+int manifest_add(manifest_t *man, const manifest_entry_t *output);
+
+/// @brief finds the record for an output of the current input
+/// @param man pointer to the manifest
+/// @param name name of the output file
+/// @return pointer to the record, NULL if there is none
+const manifest_entry_t *manifest_find(const manifest_t *man, const char *name);
+
+/// @brief checks an output file of the current input is as recorded, by its size and
+/// modification time, and optionally its contents
+/// @param man pointer to the manifest
+/// @param name name of the output file
+/// @param verify true to also compare the CRC of the file's contents with the record
+/// @return true if the file exists and matches its record
+bool manifest_current(const manifest_t *man, const char *name, bool verify);
+
+#endif
@@ -0,0 +1,78 @@
+/*
+ * mihash.h
+ * a multi-index hash for finding 64 bit hashes within a given Hamming distance
+ *
+ * For a search radius 'r' each hash is split into r+1 substrings. Two hashes that differ
+ * in at most r bits must have at least one of these substrings exactly the same, so each
+ * substring of the query is looked up in its own table, and only the hashes found there
+ * are compared in full. For r=8 the substrings are 7 or 8 bits, and well spread hashes
+ * give around 9/128ths of the index as candidates, where a BK-tree search at that radius
+ * visits most of its nodes.
+ *
+ * The substrings get shorter as the radius grows, and past MIH_MAXCHUNKS of them the
+ * lookups cost more than comparing every hash, which is what larger radii do.
+ *
+ * This code is offered without warranty under the MIT License. Use it as you will
+ * personally or commercially, just give credit if you do.
+ */
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef CA_MIHASH
+#define CA_MIHASH
+
+#define MIH_MAXCHUNKS (13)  // most substrings used, of 4 or 5 bits, for a radius of 12
+
+typedef struct {
+    uint64_t    hash;       // the hash
+    size_t      id;         // caller's identifier for the hash
+} mih_entry_t;
+
+typedef struct {
+    int         radius;                 // the radius the index is built for
+    int         num_chunks;             // number of substrings, 0 to compare every hash
+    uint8_t     shift[MIH_MAXCHUNKS];   // position of the first bit of each substring
+    uint8_t     bits[MIH_MAXCHUNKS];    // number of bits in each substring
+    mih_entry_t *entries;   // the hashes, in the order they were added
+    size_t      count;      // number of hashes
+    size_t      size;       // number of entries allocated
+    uint32_t    *tables[MIH_MAXCHUNKS]; // per substring, the entries sorted by that substring
+    uint32_t    *seen;      // the last query to find each entry, so each is compared once
+    uint32_t    stamp;      // the current query
+} mihash_t;
+
+/// @brief called for each hash found by mihash_query()
+/// @param ctx the context pointer given to mihash_query()
+/// @param id the identifier of the hash found
+/// @param dist the distance of the hash found from the query
+typedef void (*mihash_fn_t)(void *ctx, size_t id, int dist);
+
+/// @brief initializes an empty index
+/// @param mih the index
+/// @param radius the largest Hamming distance that will be searched for, 0-64
+void mihash_init(mihash_t *mih, int radius);
+
+/// @brief releases all memory held by the index
+void mihash_free(mihash_t *mih);
+
+/// @brief adds a hash to the index, call mihash_build() once they are all added
+/// @param mih the index
+/// @param hash the hash to add
+/// @param id the caller's identifier for the hash
+/// @return 0 on success, -1 if out of memory
+int mihash_add(mihash_t *mih, uint64_t hash, size_t id);
+
+/// @brief builds the substring tables for all the hashes added
+/// @param mih the index
+/// @return 0 on success, -1 if out of memory
+int mihash_build(mihash_t *mih);
+
+/// @brief finds all the hashes within the index's radius of 'hash', one query at a time
+/// @param mih the built index
+/// @param hash the hash to search for
+/// @param fn function called for each match
+/// @param ctx context pointer passed to fn
+/// @return number of matches found
+size_t mihash_query(mihash_t *mih, uint64_t hash, mihash_fn_t fn, void *ctx);
+
+#endif
@@ -0,0 +1,33 @@
+/*
+ * parallel.h 
+ * a minimal thread pool for running independent work items in parallel
+ * 
+ * This code is offered without warranty under the MIT License. Use it as you will 
+ * personally or commercially, just give credit if you do.
+ */
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef CA_PARALLEL
+#define CA_PARALLEL
+
+/// @brief function called for each work item
+/// @param ctx the context pointer given to parallel_for()
+/// @param index index of the work item, 0 to count-1
+/// @param thread index of the thread running the item, 0 to threads-1
+typedef void (*parallel_fn_t)(void *ctx, size_t index, int thread);
+
+/// @brief determines the number of threads to use by default
+/// @return number of online processors, at least 1
+int parallel_threads(void);
+
+/// @brief runs fn for every index from 0 to count-1, spread over a number of threads.
+/// Items are handed out one at a time in order, so the load balances itself.
+/// @param count number of work items
+/// @param threads number of threads to use, 0 for parallel_threads()
+/// @param fn function to call for each item
+/// @param ctx context pointer passed through to fn
+/// @return 0 on success, -1 if the threads could not be started
+int parallel_for(size_t count, int threads, parallel_fn_t fn, void *ctx);
+
+#endif
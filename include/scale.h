@@ -0,0 +1,47 @@
+/*
+ * scale.h 
+ * interface definitions for upscaling indexed (1 byte per pixel) image data
+ * 
+ * This code is offered without warranty under the MIT License. Use it as you will 
+ * personally or commercially, just give credit if you do.
+ */
+#include <stdint.h>
+#include "memstream.h"
+
+#ifndef CA_SCALE
+#define CA_SCALE
+
+typedef enum {
+    SCALE_NONE = 0,     // 1:1, no scaling
+    SCALE_2X,           // integer 2x nearest neighbour
+    SCALE_3X,           // integer 3x nearest neighbour
+    SCALE_4X,           // integer 4x nearest neighbour
+    SCALE_ASPECT_240,   // aspect correction, 320x200 -> 320x240
+    SCALE_ASPECT_480,   // aspect correction, 320x200 -> 640x480
+} scale_mode_t;
+
+/// @brief parses a scaling mode name, one of "2x", "3x", "4x", "240", or "480"
+/// @param name string with the name of the mode
+/// @return the scaling mode, or -1 if the name is not recognized
+int scale_parse(const char *name);
+
+/// @brief determines the dimensions of the image after scaling
+/// @param mode the scaling mode
+/// @param width width of the source image in pixels
+/// @param height height of the source image in pixels
+/// @param dst_width pointer to a var to hold the scaled width
+/// @param dst_height pointer to a var to hold the scaled height
+void scale_dims(scale_mode_t mode, uint16_t width, uint16_t height, uint16_t *dst_width, uint16_t *dst_height);
+
+/// @brief upscales the indexed image in src into dst using nearest neighbour sampling
+/// each destination line is produced in a single pass, lines that repeat the previous
+/// source line are copied from the previous destination line
+/// @param dst memstream buffer large enough to hold the scaled image
+/// @param src memstream buffer with the source image data
+/// @param width width of the source image in pixels
+/// @param height height of the source image in pixels
+/// @param mode the scaling mode
+/// @return 0 on success, -1 on bad parameters or if dst is too small
+int scale_image(memstream_buf_t *dst, memstream_buf_t *src, uint16_t width, uint16_t height, scale_mode_t mode);
+
+#endif
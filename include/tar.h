@@ -0,0 +1,42 @@
+/*
+ * tar.h 
+ * interface definitions for writing a POSIX ustar archive as a single sequential stream
+ * 
+ * This code is offered without warranty under the MIT License. Use it as you will 
+ * personally or commercially, just give credit if you do.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#ifndef CA_TAR
+#define CA_TAR
+
+#define TAR_BLOCKSZ (512)   // size of a tar block, headers and data are padded to this
+#define TAR_NAMESZ  (100)   // maximum length of an entry name, including the terminator
+
+typedef struct {
+    uint8_t block[TAR_BLOCKSZ];
+} tar_header_t;
+
+/// @brief fills in the fields of a header template that are the same for every entry, so
+/// only the name, size, and checksum need to be set for each entry written
+/// @param tmpl pointer to the header template
+/// @param mtime modification time to give the entries
+void tar_header_init(tar_header_t *tmpl, time_t mtime);
+
+/// @brief writes a regular file entry, the header followed by the data padded out to a whole block
+/// @param fp the open output stream
+/// @param tmpl header template from tar_header_init()
+/// @param name name of the entry
+/// @param data pointer to the contents of the entry
+/// @param size size of the contents in bytes
+/// @return 0 on success, -1 if the name is too long, -2 on a write error
+int tar_write_entry(FILE *fp, const tar_header_t *tmpl, const char *name, const void *data, size_t size);
+
+/// @brief writes the end of archive marker (two empty blocks)
+/// @param fp the open output stream
+/// @return 0 on success
+int tar_write_end(FILE *fp);
+
+#endif
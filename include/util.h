@@ -25,6 +25,18 @@ void drop_extension(char *fn);
 /// @return a pointer to the filename portion of the path string
 char *filename(char *path);
 
+/// @brief prints a string as a JSON string, escaping as needed
+/// @param fo handle to an open file
+/// @param s the string, it ends at 'len' characters or a null, whichever is first
+/// @param len maximum length of the string
+void json_str(FILE *fo, const char *s, int len);
+
+/// @brief prints a string as a CSV field, quoting it
+/// @param fo handle to an open file
+/// @param s the string, it ends at 'len' characters or a null, whichever is first
+/// @param len maximum length of the string
+void csv_str(FILE *fo, const char *s, int len);
+
 // convenience "safe" resource release functons
 #define fclose_s(A) if(A) fclose(A); A=NULL
 #define free_s(A) if(A) free(A); A=NULL
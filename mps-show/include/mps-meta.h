@@ -0,0 +1,85 @@
+/*
+ * mps-meta.h
+ * compact parsed form of the slide information block of a MicroProse MPSShow file
+ *
+ * The info block is an array of packed 835 byte records, 768 bytes of which are the
+ * palette. Code that only needs the offsets, lengths, and names of the slides, such as
+ * listing or indexing many shows, should use this form. It holds each field in its own
+ * aligned array, the names and descriptions as interned strings, and only the distinct
+ * palettes, so scans stay in cache and an open show needs a fraction of the memory.
+ *
+ * This code is offered without warranty under the MIT License. Use it as you will
+ * personally or commercially, just give credit if you do.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include "mps-show.h"
+
+#ifndef MPS_META
+#define MPS_META
+
+typedef struct {
+    int         count;          // number of slides
+    // hot data, one entry per slide in each array
+    uint32_t    *img_offset;    // offset of each image in the file
+    uint16_t    *img_len;       // length of each image's compressed data
+    uint16_t    *mode;          // video mode
+    uint32_t    *unknown32;
+    uint16_t    *name;          // offset of each slide's name in 'strings'
+    uint16_t    *desc;          // offset of each slide's description in 'strings'
+    uint8_t     *pal;           // index of each slide's palette in 'pals'
+    // cold data
+    uint8_t     *name_len;      // each slide's name length byte, as it is in the file
+    uint8_t     *desc_len;      // each slide's description length byte, as it is in the file
+    uint8_t     (*unknown)[19]; // the unknown data after each palette
+    char        *strings;       // interned null terminated names and descriptions
+    size_t      strings_len;    // size of 'strings' in bytes
+    int         num_pals;       // number of distinct palettes
+    pal_entry_t (*pals)[256];   // distinct palettes (0-63 per component)
+    void        *block;         // allocation holding the per slide arrays
+} mps_meta_t;
+
+/// @brief builds the compact form of an info block
+/// @param slide_info pointer to the info records of the slides
+/// @param count number of slides
+/// @return pointer to the allocated metadata, free with mps_meta_free(), NULL on failure
+mps_meta_t *mps_meta_parse(const info_t *slide_info, int count);
+
+/// @brief Reads in the slide information block in its compact form
+/// @param fp pointer to an open file with the MpsShow data
+/// @return pointer to the allocated metadata, free with mps_meta_free(), NULL on failure
+mps_meta_t *read_mps_show_meta(FILE *fp);
+
+#ifndef _WIN32
+/// @brief Reads in the slide information block in its compact form, using a positional read
+/// @param fd open file descriptor for the MpsShow data
+/// @return pointer to the allocated metadata, free with mps_meta_free(), NULL on failure
+mps_meta_t *read_mps_show_meta_fd(int fd);
+#endif
+
+/// @brief releases the metadata
+/// @param meta pointer returned by mps_meta_parse() or read_mps_show_meta()
+void mps_meta_free(mps_meta_t *meta);
+
+/// @brief rebuilds the full info record of a slide, for use with read_mps_show_image() and such
+/// @param meta pointer to the metadata
+/// @param index 0 based index of the slide
+/// @param slide pointer to the record to fill in
+void mps_meta_info(const mps_meta_t *meta, int index, info_t *slide);
+
+/// @brief name of a slide
+static inline const char *mps_meta_name(const mps_meta_t *meta, int index) {
+    return &meta->strings[meta->name[index]];
+}
+
+/// @brief description of a slide
+static inline const char *mps_meta_desc(const mps_meta_t *meta, int index) {
+    return &meta->strings[meta->desc[index]];
+}
+
+/// @brief palette of a slide (0-63 per component)
+static inline const pal_entry_t *mps_meta_palette(const mps_meta_t *meta, int index) {
+    return meta->pals[meta->pal[index]];
+}
+
+#endif
@@ -0,0 +1,34 @@
+/*
+ * mps-phash.h 
+ * interface definitions for computing perceptual hashes of MPSShow slides
+ * 
+ * This code is offered without warranty under the MIT License. Use it as you will 
+ * personally or commercially, just give credit if you do.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include "mps-show.h"
+
+#ifndef MPS_PHASH
+#define MPS_PHASH
+
+/// @brief computes the difference hash (dHash) of a slide from its compressed data.
+/// The slide is decoded with the palette applied as a 1/8 size thumbnail, reduced to a
+/// 9x8 grid of luminance values, and each bit of the hash is set if a cell is brighter
+/// than its right hand neighbour. Similar images give hashes with a small Hamming distance,
+/// even after being re-encoded, or with a shifted palette.
+/// @param hash pointer to hold the 64 bit hash
+/// @param src pointer to a memstream buffer with the compressed datastream
+/// @param pal pointer to the 256 entry VGA palette (0-63 per component) of the slide
+/// @return 0 on success
+int mps_phash(uint64_t *hash, memstream_buf_t *src, pal_entry_t *pal);
+
+/// @brief number of bits that differ between two hashes
+/// @param a first hash
+/// @param b second hash
+/// @return the Hamming distance between the hashes (0-64)
+static inline int phash_distance(uint64_t a, uint64_t b) {
+    return __builtin_popcountll(a ^ b);
+}
+
+#endif
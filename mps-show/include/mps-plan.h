@@ -0,0 +1,66 @@
+/*
+ * mps-plan.h
+ * read planning for decoding many slides of a MicroProse MPSShow file at once
+ *
+ * Rather than a seek and a read per slide, in slide order, the image data of the slides
+ * wanted is sorted by its position in the file and nearby images are merged into a few
+ * large sequential reads. The operating system is told about the reads before they are
+ * made, so it can start reading ahead, and the slides are then decoded from memory.
+ *
+ * This code is offered without warranty under the MIT License. Use it as you will
+ * personally or commercially, just give credit if you do.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include "mps-show.h"
+
+#ifndef MPS_PLAN
+#define MPS_PLAN
+
+#define MPS_PLAN_GAP (64 * 1024)  // default largest gap between images to read through
+
+// a single read covering the image data of one or more slides
+typedef struct {
+    uint32_t    offset;     // position in the file
+    uint32_t    len;        // number of bytes to read
+    uint8_t     *data;      // the data, once loaded
+} mps_range_t;
+
+typedef struct {
+    int         count;      // number of slides
+    int         *range;     // index of the read holding each slide's image, -1 if not wanted
+    uint32_t    *offset;    // position of each slide's image in the file
+    uint16_t    *len;       // length of each slide's compressed image
+    int         num_ranges; // number of reads
+    mps_range_t *ranges;    // the reads, in file order
+} mps_plan_t;
+
+/// @brief plans the reads for a set of slides
+/// @param slide_info pointer to the info records of the slides
+/// @param count number of slides
+/// @param want array of 'count' flags for the slides to read, NULL for all of them
+/// @param max_gap largest number of unwanted bytes between two images that will be read
+/// through to merge them into a single read, e.g. MPS_PLAN_GAP
+/// @return pointer to the allocated plan, free with mps_plan_free(), NULL on failure
+mps_plan_t *mps_plan_create(const info_t *slide_info, int count, const uint8_t *want, uint32_t max_gap);
+
+/// @brief reads in the image data of all the slides in the plan. A read that fails, e.g.
+/// one that runs past the end of a truncated file, is left unloaded and the others are
+/// still made, so the slides it covers can be read singly with read_mps_show_image().
+/// @param plan pointer to the plan
+/// @param fp pointer to an open file with the image data
+/// @return 0 if everything was read, otherwise the number of reads that failed
+int mps_plan_load(mps_plan_t *plan, FILE *fp);
+
+/// @brief decodes the image of a slide from the loaded data
+/// @param plan pointer to a loaded plan
+/// @param index 0 based index of the slide, it must be one of the slides planned
+/// @param dst pointer to an allocaed buffer large enough to hold the uncompressed image
+/// @return 0 on success, -1 if the slide's data was not loaded or does not decode
+int mps_plan_image(const mps_plan_t *plan, int index, memstream_buf_t *dst);
+
+/// @brief releases the plan and any data loaded
+/// @param plan pointer returned by mps_plan_create()
+void mps_plan_free(mps_plan_t *plan);
+
+#endif
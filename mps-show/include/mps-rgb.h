@@ -0,0 +1,52 @@
+/*
+ * mps-rgb.h
+ * decoding MPSShow slides straight to true colour images
+ *
+ * The RLE data is decoded with the palette applied as each run is filled, so no indexed
+ * image is needed, and there is no second pass over the image to look up the colours.
+ * Runs are filled with wide vector stores where the CPU supports them.
+ *
+ * This code is offered without warranty under the MIT License. Use it as you will
+ * personally or commercially, just give credit if you do.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include "mps-show.h"
+
+#ifndef MPS_RGB
+#define MPS_RGB
+
+/// @brief converts a VGA palette to 32 bit RGBA colours, stored as the bytes R, G, B, A in
+/// memory, with an alpha of 255
+/// @param lut pointer to a 256 entry table for the colours
+/// @param pal pointer to the 256 entry VGA palette (0-63 per component)
+void mps_rgb_lut32(uint32_t *lut, const pal_entry_t *pal);
+
+/// @brief converts a VGA palette to 16 bit RGB565 colours, in the native byte order
+/// @param lut pointer to a 256 entry table for the colours
+/// @param pal pointer to the 256 entry VGA palette (0-63 per component)
+void mps_rgb_lut565(uint16_t *lut, const pal_entry_t *pal);
+
+/// @brief RLE decompresses the input datastream to 32 bit RGBA pixels (R, G, B, A bytes)
+/// the same as rle_decompress() followed by a palette lookup, a trailing odd byte is ignored
+/// @param dst pointer to a memstream buffer to hold the image, 4 bytes per pixel
+/// @param src pointer to a memstream buffer with the compressed datastream
+/// @param pal pointer to the 256 entry VGA palette (0-63 per component) of the slide
+/// @return 0 on success, -1 if destination is too small
+int rle_decompress_rgba32(memstream_buf_t *dst, memstream_buf_t *src, const pal_entry_t *pal);
+
+/// @brief RLE decompresses the input datastream to 24 bit RGB pixels (R, G, B bytes)
+/// @param dst pointer to a memstream buffer to hold the image, 3 bytes per pixel
+/// @param src pointer to a memstream buffer with the compressed datastream
+/// @param pal pointer to the 256 entry VGA palette (0-63 per component) of the slide
+/// @return 0 on success, -1 if destination is too small
+int rle_decompress_rgb24(memstream_buf_t *dst, memstream_buf_t *src, const pal_entry_t *pal);
+
+/// @brief RLE decompresses the input datastream to 16 bit RGB565 pixels, in the native byte order
+/// @param dst pointer to a memstream buffer to hold the image, 2 bytes per pixel
+/// @param src pointer to a memstream buffer with the compressed datastream
+/// @param pal pointer to the 256 entry VGA palette (0-63 per component) of the slide
+/// @return 0 on success, -1 if destination is too small
+int rle_decompress_rgb565(memstream_buf_t *dst, memstream_buf_t *src, const pal_entry_t *pal);
+
+#endif
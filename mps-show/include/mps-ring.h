@@ -0,0 +1,180 @@
+/*
+ * mps-ring.h
+ * a ring of decoded slides in shared memory, for handing frames to other processes
+ *
+ * The ring is a POSIX shared memory object (or an anonymous memfd) holding a fixed number
+ * of frame slots. A single producer decodes slides straight into the slots, and any
+ * number of consumer processes map the same memory and use the frames in place, so no
+ * frame is ever copied or written to a file.
+ *
+ * Each slot has a sequence counter (a seqlock). It is odd while the slot is being written,
+ * and 2n+2 once it holds frame 'n', so a consumer can tell that a frame is complete, and
+ * whether it has since been overwritten, without any locks. By default the producer never
+ * waits, and a consumer that falls more than a ring behind loses frames. With
+ * MPS_RING_WAIT the producer instead waits for a single consumer to release each frame.
+ *
+ * The consumer side is the small 'mpsring' library, which does not need the rest of the
+ * mpsshow library. The producer side, mps_ring_put_image(), is part of mpsshow. Both
+ * are only available on POSIX systems.
+ *
+ * This code is offered without warranty under the MIT License. Use it as you will
+ * personally or commercially, just give credit if you do.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <stdalign.h>
+#include <stdio.h>
+#include "mps-show.h"
+
+#ifndef MPS_RING
+#define MPS_RING
+
+#define MPS_RING_MAGIC   (0x474e5252)   // "RRNG"
+#define MPS_RING_VERSION (1)
+#define MPS_RING_FRAMESZ (MPS_WIDTH * MPS_HEIGHT)   // bytes of indexed pixels in a slot
+#define MPS_RING_SLOTS   (8)            // default number of slots
+
+#define MPS_RING_WAIT    (1)            // flag, the producer waits rather than overwrite a frame
+
+// results of reading a frame
+#define MPS_RING_READY   (0)            // the frame is complete
+#define MPS_RING_EMPTY   (1)            // the frame has not been written yet
+#define MPS_RING_END     (2)            // the producer has finished, the frame will never be written
+#define MPS_RING_OVERRUN (-1)           // the frame has been overwritten by a later one
+
+// the shared ring header, the counters written by each side are on their own cache line
+typedef struct {
+    uint32_t    magic;
+    uint32_t    version;
+    uint32_t    num_slots;      // number of frame slots
+    uint32_t    slot_size;      // size of a slot in bytes
+    uint32_t    flags;          // as given to mps_ring_create()
+    alignas(64) _Atomic uint64_t head;      // number of frames written by the producer
+    _Atomic uint32_t closed;                // non zero once the producer has finished
+    alignas(64) _Atomic uint64_t tail;      // number of frames released by the consumer
+} mps_ring_hdr_t;
+
+// a frame slot, the slots follow the header
+typedef struct {
+    _Atomic uint64_t seq;       // 2n+1 while frame 'n' is being written, 2n+2 once it is complete
+    uint32_t    slide;          // index of the slide in its show
+    uint32_t    len;            // number of pixels decoded, any after these are 0
+    char        name[16];       // name of the slide, null terminated
+    alignas(64) pal_entry_t pal[256];   // the slide's VGA palette (0-63 per component)
+    uint8_t     pixels[MPS_RING_FRAMESZ];   // the indexed image, MPS_WIDTH x MPS_HEIGHT
+} mps_ring_slot_t;
+
+// a mapping of a ring, in either the producer or a consumer
+typedef struct {
+    int             fd;
+    size_t          size;       // size of the mapping
+    mps_ring_hdr_t  *hdr;
+    uint8_t         *slots;     // the first slot
+    char            *name;      // name of the shared memory object, NULL for a memfd
+    bool            owner;      // this is the producer, which removes the name on close
+} mps_ring_t;
+
+/// @brief creates a new ring, the producer side
+/// @param name name of the POSIX shared memory object, e.g. "/mps-ring", or NULL for an
+/// anonymous memfd (Linux only) that is shared by passing on the descriptor (mps_ring_t.fd)
+/// @param num_slots number of frame slots, e.g. MPS_RING_SLOTS
+/// @param flags 0, or MPS_RING_WAIT
+/// @return pointer to the ring, close with mps_ring_close(), NULL on failure
+mps_ring_t *mps_ring_create(const char *name, int num_slots, uint32_t flags);
+
+/// @brief maps an existing ring, the consumer side
+/// @param name name of the POSIX shared memory object
+/// @return pointer to the ring, close with mps_ring_close(), NULL on failure
+mps_ring_t *mps_ring_open(const char *name);
+
+/// @brief maps an existing ring from a descriptor, e.g. a memfd inherited from the producer
+/// @param fd the open descriptor, it is closed by mps_ring_close()
+/// @return pointer to the ring, close with mps_ring_close(), NULL on failure
+mps_ring_t *mps_ring_open_fd(int fd);
+
+/// @brief unmaps the ring, the producer also removes its name, though consumers that
+/// already have it mapped can carry on using it
+/// @param ring pointer to the ring
+void mps_ring_close(mps_ring_t *ring);
+
+/// @brief the slot that frame 'n' is written to
+static inline mps_ring_slot_t *mps_ring_slot(const mps_ring_t *ring, uint64_t n) {
+    return (mps_ring_slot_t *)&ring->slots[(n % ring->hdr->num_slots) * ring->hdr->slot_size];
+}
+
+/// @brief the number of frames the producer has written so far
+static inline uint64_t mps_ring_head(const mps_ring_t *ring) {
+    return atomic_load_explicit(&ring->hdr->head, memory_order_acquire);
+}
+
+// producer side
+
+/// @brief starts writing the next frame, waiting for a free slot with MPS_RING_WAIT
+/// @param ring pointer to the ring
+/// @return pointer to the slot to fill in, finish with mps_ring_commit() or mps_ring_abort()
+mps_ring_slot_t *mps_ring_begin(mps_ring_t *ring);
+
+/// @brief publishes the frame started by mps_ring_begin()
+/// @param ring pointer to the ring
+void mps_ring_commit(mps_ring_t *ring);
+
+/// @brief abandons the frame started by mps_ring_begin(), the slot is left empty
+/// @param ring pointer to the ring
+void mps_ring_abort(mps_ring_t *ring);
+
+/// @brief marks the end of the frames, waiting consumers see MPS_RING_END
+/// @param ring pointer to the ring
+void mps_ring_end(mps_ring_t *ring);
+
+/// @brief decodes a slide with read_mps_show_image() straight into the next slot, and
+/// publishes it (part of the mpsshow library)
+/// @param ring pointer to the ring
+/// @param fp pointer to an open file with the image data
+/// @param slide pointer to a slide record for the image to load
+/// @param index index of the slide in its show, passed on to the consumers
+/// @return 0 on success, nothing is published on failure
+int mps_ring_put_image(mps_ring_t *ring, FILE *fp, info_t *slide, uint32_t index);
+
+/// @brief as mps_ring_put_image(), with read_mps_show_image_fd()
+int mps_ring_put_image_fd(mps_ring_t *ring, int fd, const info_t *slide, uint32_t index);
+
+// consumer side
+
+/// @brief waits for frame 'n' to be written
+/// @param ring pointer to the ring
+/// @param n the frame number, counting from 0
+/// @param timeout_ms longest time to wait, in milliseconds, or -1 to wait for ever
+/// @return MPS_RING_READY, MPS_RING_END, or MPS_RING_EMPTY if the time ran out
+int mps_ring_wait(const mps_ring_t *ring, uint64_t n, int timeout_ms);
+
+/// @brief gets frame 'n' to use in place, with no copy. Unless the ring was created with
+/// MPS_RING_WAIT, the producer may overwrite the frame while it is being used, so call
+/// mps_ring_check() when done with it to make sure it was not.
+/// @param ring pointer to the ring
+/// @param n the frame number
+/// @param slot pointer to hold the frame's slot
+/// @return MPS_RING_READY, MPS_RING_EMPTY, MPS_RING_END, or MPS_RING_OVERRUN
+int mps_ring_peek(const mps_ring_t *ring, uint64_t n, const mps_ring_slot_t **slot);
+
+/// @brief checks that frame 'n' is still in its slot, after it has been used
+/// @param ring pointer to the ring
+/// @param n the frame number
+/// @return MPS_RING_READY if it was not overwritten, otherwise MPS_RING_OVERRUN
+int mps_ring_check(const mps_ring_t *ring, uint64_t n);
+
+/// @brief copies frame 'n' out of the ring, for a consumer that needs to keep it
+/// @param ring pointer to the ring
+/// @param n the frame number
+/// @param pixels buffer of MPS_RING_FRAMESZ bytes for the image
+/// @param pal buffer of 256 entries for the palette
+/// @return MPS_RING_READY, MPS_RING_EMPTY, MPS_RING_END, or MPS_RING_OVERRUN
+int mps_ring_read(const mps_ring_t *ring, uint64_t n, uint8_t *pixels, pal_entry_t *pal);
+
+/// @brief releases the frames up to and including 'n', so a MPS_RING_WAIT producer can
+/// reuse their slots
+/// @param ring pointer to the ring
+/// @param n the frame number
+void mps_ring_release(mps_ring_t *ring, uint64_t n);
+
+#endif
@@ -6,6 +6,7 @@
  * personally or commercially, just give credit if you do.
  */
 #include <stdint.h>
+#include <stdio.h>
 #include "pal.h"
 #include "memstream.h"
 
@@ -31,6 +32,8 @@ typedef struct {
 #pragma pack(pop)
 
 #define MPSRECSZ (835)    // size of MPSShow info record
+#define MPS_WIDTH (320)   // width of a slide image in pixels
+#define MPS_HEIGHT (200)  // height of a slide image in pixels
 
 /// @brief Reads in the slide information block
 /// @param fp pointer to an open file with the MpsShow data
@@ -39,6 +42,20 @@ typedef struct {
 /// returns NULL on failure
 info_t *read_mps_show_info_header(FILE *fp, int *count);
 
+/// @brief RLE decompresses the input datastream
+/// RLE format is as a stream of 16 bit records (count and data)
+/// @param dst pointer to a memstream buffer to hold teh uncompressed data
+/// @param src pointer to a memstream buffer with hte compressed datastream
+/// @return 0 on success, -1 if destination is too small
+int rle_decompress(memstream_buf_t *dst, memstream_buf_t *src);
+
+/// @brief Reads in the compressed (RLE) data for the image referenced by 'slide'
+/// @param src pointer to a memstream buffer, its data is allocated by this function
+/// @param fp pointer to an open file with the image data
+/// @param slide pointer to a slide record for the image to load
+/// @return returns 0 on success
+int read_mps_show_rle(memstream_buf_t *src, FILE *fp, info_t *slide);
+
 /// @brief Reads in the image referenced by 'slide'
 /// @param dst pointer to an allocaed buffer large enough to hold the uncompressed image
 /// @param fp pointer to an open file with the image data
@@ -46,4 +63,53 @@ info_t *read_mps_show_info_header(FILE *fp, int *count);
 /// @return returns 0 on success
 int read_mps_show_image(memstream_buf_t *dst, FILE *fp, info_t *slide);
 
+#ifndef _WIN32
+// Reentrant variants of the above, these use positional reads (pread) on a file
+// descriptor, and so never move a shared file position. Any number of threads may
+// read from the same open descriptor at the same time without any locking.
+
+/// @brief Reads in the slide information block
+/// @param fd open file descriptor for the MpsShow data
+/// @param count pointer to a var for holding the slide count
+/// @return pointer to allocated memory containing all the info records for all the slides
+/// returns NULL on failure
+info_t *read_mps_show_info_header_fd(int fd, int *count);
+
+/// @brief Reads in the compressed (RLE) data for the image referenced by 'slide'
+/// @param src pointer to a memstream buffer, its data is allocated by this function
+/// @param fd open file descriptor for the image data
+/// @param slide pointer to a slide record for the image to load
+/// @return returns 0 on success
+int read_mps_show_rle_fd(memstream_buf_t *src, int fd, const info_t *slide);
+
+/// @brief Reads in the compressed (RLE) data at a given position, for callers that keep
+/// the image offsets and lengths without the full slide records, e.g. mps_meta_t
+/// @param src pointer to a memstream buffer, its data is allocated by this function
+/// @param fd open file descriptor for the image data
+/// @param offset position of the image data in the file
+/// @param len length of the image data
+/// @return returns 0 on success
+int read_mps_show_rle_at_fd(memstream_buf_t *src, int fd, uint32_t offset, uint32_t len);
+
+/// @brief Reads in the image referenced by 'slide'
+/// @param dst pointer to an allocaed buffer large enough to hold the uncompressed image
+/// @param fd open file descriptor for the image data
+/// @param slide pointer to a slide record for the image to load
+/// @return returns 0 on success
+int read_mps_show_image_fd(memstream_buf_t *dst, int fd, const info_t *slide);
+
+#define RLE_PARALLEL_MIN (1 << 20)  // smallest output, in bytes, rle_decompress_parallel() will split
+
+/// @brief RLE decompresses the input datastream using several threads, for very large images.
+/// The run counts are summed to find where each part of the stream is written, and the
+/// parts are decoded at the same time. The result is identical to rle_decompress(), which
+/// is used instead for output smaller than RLE_PARALLEL_MIN, a stream of odd length, or a
+/// destination that is too small.
+/// @param dst pointer to a memstream buffer to hold teh uncompressed data
+/// @param src pointer to a memstream buffer with hte compressed datastream
+/// @param threads number of threads to use, including the calling thread
+/// @return 0 on success, -1 if destination is too small
+int rle_decompress_parallel(memstream_buf_t *dst, memstream_buf_t *src, int threads);
+#endif
+
 #endif
@@ -0,0 +1,44 @@
+/*
+ * mps-thumb.h 
+ * interface definitions for generating downscaled truecolour thumbnails of MPSShow slides
+ * 
+ * This code is offered without warranty under the MIT License. Use it as you will 
+ * personally or commercially, just give credit if you do.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include "mps-show.h"
+
+#ifndef MPS_THUMB
+#define MPS_THUMB
+
+#define THUMB_BPP (3)   // bytes per pixel of a thumbnail (R G B)
+
+/// @brief checks that the scale factor is one we support (2, 4, or 8)
+/// @param scale the downscale factor
+/// @return true (non zero) if the scale is supported
+int thumb_scale_valid(int scale);
+
+/// @brief computes the size in bytes of a thumbnail buffer for the given scale
+/// @param scale the downscale factor (2, 4, or 8)
+/// @return size of the buffer in bytes, 0 if the scale is not supported
+size_t thumb_size(int scale);
+
+/// @brief RLE decompresses the input datastream while downscaling it, the runs are
+/// box filtered in RGB directly into the thumbnail without an intermediate full size image
+/// @param dst pointer to a memstream buffer to hold the RGB thumbnail, at least thumb_size(scale) bytes
+/// @param src pointer to a memstream buffer with the compressed datastream
+/// @param pal pointer to the 256 entry VGA palette (0-63 per component) of the slide
+/// @param scale the downscale factor (2, 4, or 8)
+/// @return 0 on success, -1 if the stream decodes to more than a full image, or bad parameters
+int rle_decompress_thumbnail(memstream_buf_t *dst, memstream_buf_t *src, pal_entry_t *pal, int scale);
+
+/// @brief Reads in the image referenced by 'slide' as a downscaled RGB thumbnail
+/// @param dst pointer to an allocated buffer large enough to hold the thumbnail
+/// @param fp pointer to an open file with the image data
+/// @param slide pointer to a slide record for the image to load
+/// @param scale the downscale factor (2, 4, or 8)
+/// @return returns 0 on success
+int read_mps_show_thumbnail(memstream_buf_t *dst, FILE *fp, info_t *slide, int scale);
+
+#endif
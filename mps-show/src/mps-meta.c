@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mps-meta.h"
+#include "util.h"
+
+#define META_ALIGN (64)   // per slide arrays start on their own cache line
+
+#define NAME_MAX_LEN (9)
+#define DESC_MAX_LEN (25)
+
+/// @brief rounds a size up to the array alignment
+static size_t meta_align(size_t sz) {
+    return (sz + META_ALIGN - 1) & ~(size_t)(META_ALIGN - 1);
+}
+
+/// @brief FNV-1a hash, used to quickly rule out palettes that differ
+static uint32_t meta_hash(const void *data, size_t len) {
+    const uint8_t *p = data;
+    uint32_t h = 2166136261u;
+    while(len--) {
+        h = (h ^ *p++) * 16777619u;
+    }
+    return h;
+}
+
+/// @brief adds a string to the pool, reusing an identical string already in it
+/// a show has at most 255 slides, so a linear search of the pool is cheap
+/// @return offset of the string in the pool
+static uint16_t meta_intern(mps_meta_t *meta, const char *str, int len) {
+    size_t pos = 0;
+    while(pos < meta->strings_len) {
+        size_t n = strlen(&meta->strings[pos]);
+        if((n == (size_t)len) && (0 == memcmp(&meta->strings[pos], str, len))) {
+            return (uint16_t)pos;
+        }
+        pos += n + 1;
+    }
+    memcpy(&meta->strings[pos], str, len);
+    meta->strings[pos + len] = 0;
+    meta->strings_len = pos + len + 1;
+    return (uint16_t)pos;
+}
+
+mps_meta_t *mps_meta_parse(const info_t *slide_info, int count) {
+    mps_meta_t *meta = NULL;
+    uint32_t *pal_hash = NULL;
+
+    if((count < 1) || (count > 255)) {
+        return NULL;
+    }
+    if(NULL == (meta = calloc(1, sizeof(mps_meta_t)))) {
+        return NULL;
+    }
+    meta->count = count;
+
+    // all the per slide arrays share one allocation, each aligned to a cache line
+    size_t sz_offset = meta_align(count * sizeof(uint32_t));
+    size_t sz_len = meta_align(count * sizeof(uint16_t));
+    size_t sz_mode = meta_align(count * sizeof(uint16_t));
+    size_t sz_u32 = meta_align(count * sizeof(uint32_t));
+    size_t sz_name = meta_align(count * sizeof(uint16_t));
+    size_t sz_desc = meta_align(count * sizeof(uint16_t));
+    size_t sz_pal = meta_align(count * sizeof(uint8_t));
+    size_t sz_name_len = meta_align(count * sizeof(uint8_t));
+    size_t sz_desc_len = meta_align(count * sizeof(uint8_t));
+    size_t sz_unknown = meta_align(count * sizeof(slide_info->unknown));
+    size_t total = sz_offset + sz_len + sz_mode + sz_u32 + sz_name + sz_desc + sz_pal +
+        sz_name_len + sz_desc_len + sz_unknown;
+    if(NULL == (meta->block = malloc(total + META_ALIGN))) {
+        goto error;
+    }
+    uint8_t *p = (uint8_t *)meta_align((uintptr_t)meta->block);
+    meta->img_offset = (uint32_t *)p;   p += sz_offset;
+    meta->img_len = (uint16_t *)p;      p += sz_len;
+    meta->mode = (uint16_t *)p;         p += sz_mode;
+    meta->unknown32 = (uint32_t *)p;    p += sz_u32;
+    meta->name = (uint16_t *)p;         p += sz_name;
+    meta->desc = (uint16_t *)p;         p += sz_desc;
+    meta->pal = p;                      p += sz_pal;
+    meta->name_len = p;                 p += sz_name_len;
+    meta->desc_len = p;                 p += sz_desc_len;
+    meta->unknown = (uint8_t (*)[19])p;
+
+    // the pools are sized for the worst case, then trimmed to what was used
+    if((NULL == (meta->strings = malloc(count * (NAME_MAX_LEN + DESC_MAX_LEN + 2)))) ||
+       (NULL == (meta->pals = malloc(count * sizeof(meta->pals[0])))) ||
+       (NULL == (pal_hash = malloc(count * sizeof(uint32_t))))) {
+        goto error;
+    }
+
+    for(int i = 0; i < count; i++) {
+        const info_t *si = &slide_info[i];
+        meta->img_offset[i] = si->img_offset;
+        meta->img_len[i] = si->img_len;
+        meta->mode[i] = si->mode;
+        meta->unknown32[i] = si->unknown32;
+        memcpy(meta->unknown[i], si->unknown, sizeof(si->unknown));
+
+        meta->name_len[i] = si->name_len;
+        meta->desc_len[i] = si->desc_len;
+        int name_len = (si->name_len > NAME_MAX_LEN) ? NAME_MAX_LEN : si->name_len;
+        int desc_len = (si->desc_len > DESC_MAX_LEN) ? DESC_MAX_LEN : si->desc_len;
+        meta->name[i] = meta_intern(meta, si->name, name_len);
+        meta->desc[i] = meta_intern(meta, si->desc, desc_len);
+
+        // shows often reuse a palette for several slides, keep only one copy of each
+        uint32_t h = meta_hash(si->pal, sizeof(si->pal));
+        int j;
+        for(j = 0; j < meta->num_pals; j++) {
+            if((pal_hash[j] == h) && (0 == memcmp(meta->pals[j], si->pal, sizeof(si->pal)))) {
+                break;
+            }
+        }
+        if(j == meta->num_pals) {
+            memcpy(meta->pals[j], si->pal, sizeof(si->pal));
+            pal_hash[j] = h;
+            meta->num_pals++;
+        }
+        meta->pal[i] = (uint8_t)j;
+    }
+    free_s(pal_hash);
+
+    // trim the pools, if this fails the larger buffers are simply kept
+    char *s = realloc(meta->strings, meta->strings_len);
+    if(s) meta->strings = s;
+    pal_entry_t (*pl)[256] = realloc(meta->pals, meta->num_pals * sizeof(meta->pals[0]));
+    if(pl) meta->pals = pl;
+    return meta;
+
+error:
+    free_s(pal_hash);
+    mps_meta_free(meta);
+    return NULL;
+}
+
+mps_meta_t *read_mps_show_meta(FILE *fp) {
+    int count = 0;
+    info_t *slide_info = read_mps_show_info_header(fp, &count);
+    if(NULL == slide_info) {
+        return NULL;
+    }
+    mps_meta_t *meta = mps_meta_parse(slide_info, count);
+    free(slide_info);
+    return meta;
+}
+
+#ifndef _WIN32
+mps_meta_t *read_mps_show_meta_fd(int fd) {
+    int count = 0;
+    info_t *slide_info = read_mps_show_info_header_fd(fd, &count);
+    if(NULL == slide_info) {
+        return NULL;
+    }
+    mps_meta_t *meta = mps_meta_parse(slide_info, count);
+    free(slide_info);
+    return meta;
+}
+#endif
+
+void mps_meta_free(mps_meta_t *meta) {
+    if(NULL == meta) {
+        return;
+    }
+    free_s(meta->block);
+    free_s(meta->strings);
+    free_s(meta->pals);
+    free(meta);
+}
+
+void mps_meta_info(const mps_meta_t *meta, int index, info_t *slide) {
+    memset(slide, 0, sizeof(info_t));
+    // the length bytes are kept as they were, a string may hold a 0 or be over long
+    slide->name_len = meta->name_len[index];
+    slide->desc_len = meta->desc_len[index];
+    memcpy(slide->name, mps_meta_name(meta, index), (slide->name_len > NAME_MAX_LEN) ? NAME_MAX_LEN : slide->name_len);
+    memcpy(slide->desc, mps_meta_desc(meta, index), (slide->desc_len > DESC_MAX_LEN) ? DESC_MAX_LEN : slide->desc_len);
+    slide->img_offset = meta->img_offset[index];
+    slide->mode = meta->mode[index];
+    slide->img_len = meta->img_len[index];
+    slide->unknown32 = meta->unknown32[index];
+    memcpy(slide->pal, mps_meta_palette(meta, index), sizeof(slide->pal));
+    memcpy(slide->unknown, meta->unknown[index], sizeof(slide->unknown));
+}
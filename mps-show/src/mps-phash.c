@@ -0,0 +1,53 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mps-phash.h"
+#include "mps-thumb.h"
+#include "util.h"
+
+#define PHASH_SCALE (8)                         // thumbnail downscale factor
+#define PHASH_TW (MPS_WIDTH / PHASH_SCALE)      // thumbnail width (40)
+#define PHASH_TH (MPS_HEIGHT / PHASH_SCALE)     // thumbnail height (25)
+#define PHASH_GW (9)                            // grid width, one more than the bits per row
+#define PHASH_GH (8)                            // grid height
+
+int mps_phash(uint64_t *hash, memstream_buf_t *src, pal_entry_t *pal) {
+    uint8_t thumb[PHASH_TW * PHASH_TH * THUMB_BPP];
+    memstream_buf_t dst = {sizeof(thumb), 0, thumb};
+
+    size_t pos = src->pos;
+    int rval = rle_decompress_thumbnail(&dst, src, pal, PHASH_SCALE);
+    src->pos = pos; // leave the source as we found it
+    if(0 != rval) {
+        return -1;
+    }
+
+    // reduce to a grid of luminance values, each cell averages the thumbnail pixels it covers
+    uint32_t grid[PHASH_GH][PHASH_GW];
+    for(int gy = 0; gy < PHASH_GH; gy++) {
+        int y0 = (gy * PHASH_TH) / PHASH_GH;
+        int y1 = ((gy + 1) * PHASH_TH) / PHASH_GH;
+        for(int gx = 0; gx < PHASH_GW; gx++) {
+            int x0 = (gx * PHASH_TW) / PHASH_GW;
+            int x1 = ((gx + 1) * PHASH_TW) / PHASH_GW;
+            uint32_t sum = 0;
+            for(int y = y0; y < y1; y++) {
+                const uint8_t *px = &thumb[(y * PHASH_TW + x0) * THUMB_BPP];
+                for(int x = x0; x < x1; x++, px += THUMB_BPP) {
+                    // integer approximation of Rec. 601 luma
+                    sum += (px[0] * 77) + (px[1] * 150) + (px[2] * 29);
+                }
+            }
+            grid[gy][gx] = sum / ((y1 - y0) * (x1 - x0));
+        }
+    }
+
+    uint64_t h = 0;
+    for(int gy = 0; gy < PHASH_GH; gy++) {
+        for(int gx = 0; gx < (PHASH_GW - 1); gx++) {
+            h = (h << 1) | (grid[gy][gx] > grid[gy][gx + 1]);
+        }
+    }
+    *hash = h;
+    return 0;
+}
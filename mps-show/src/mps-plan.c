@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#endif
+#include "mps-plan.h"
+#include "util.h"
+
+// a slide to be read, for sorting by the position of its image data
+typedef struct {
+    uint32_t    offset;
+    int         index;
+} plan_slide_t;
+
+static int plan_compare(const void *a, const void *b) {
+    const plan_slide_t *sa = a;
+    const plan_slide_t *sb = b;
+    if(sa->offset != sb->offset) {
+        return (sa->offset > sb->offset) ? 1 : -1;
+    }
+    return sa->index - sb->index;
+}
+
+mps_plan_t *mps_plan_create(const info_t *slide_info, int count, const uint8_t *want, uint32_t max_gap) {
+    mps_plan_t *plan = NULL;
+    plan_slide_t *order = NULL;
+
+    if(NULL == (plan = calloc(1, sizeof(mps_plan_t)))) {
+        return NULL;
+    }
+    plan->count = count;
+    if((NULL == (plan->range = malloc(count * sizeof(int)))) ||
+       (NULL == (plan->offset = malloc(count * sizeof(uint32_t)))) ||
+       (NULL == (plan->len = malloc(count * sizeof(uint16_t)))) ||
+       (NULL == (plan->ranges = calloc(count, sizeof(mps_range_t)))) ||
+       (NULL == (order = malloc(count * sizeof(plan_slide_t))))) {
+        goto error;
+    }
+
+    int num_wanted = 0;
+    for(int i = 0; i < count; i++) {
+        plan->range[i] = -1;
+        plan->offset[i] = slide_info[i].img_offset;
+        plan->len[i] = slide_info[i].img_len;
+        if((NULL == want) || (want[i])) {
+            order[num_wanted].offset = plan->offset[i];
+            order[num_wanted].index = i;
+            num_wanted++;
+        }
+    }
+
+    // sort by position in the file
+    qsort(order, num_wanted, sizeof(plan_slide_t), plan_compare);
+
+    // merge images that overlap, or are within 'max_gap' bytes, into the same read
+    mps_range_t *r = NULL;
+    for(int n = 0; n < num_wanted; n++) {
+        int i = order[n].index;
+        uint64_t start = plan->offset[i];
+        uint64_t end = start + plan->len[i];
+        if((r) && (start <= (uint64_t)r->offset + r->len + max_gap)) {
+            if(end > (uint64_t)r->offset + r->len) {
+                r->len = (uint32_t)(end - r->offset);
+            }
+        } else {
+            r = &plan->ranges[plan->num_ranges++];
+            r->offset = (uint32_t)start;
+            r->len = (uint32_t)(end - start);
+        }
+        plan->range[i] = plan->num_ranges - 1;
+    }
+    free_s(order);
+    return plan;
+
+error:
+    free_s(order);
+    mps_plan_free(plan);
+    return NULL;
+}
+
+int mps_plan_load(mps_plan_t *plan, FILE *fp) {
+#if !defined(_WIN32) && defined(POSIX_FADV_WILLNEED)
+    // let the kernel start on all the reads now, while the first is being waited for
+    int fd = fileno(fp);
+    for(int i = 0; i < plan->num_ranges; i++) {
+        posix_fadvise(fd, plan->ranges[i].offset, plan->ranges[i].len, POSIX_FADV_WILLNEED);
+    }
+#endif
+    // a read that fails is left unloaded, the rest are still read
+    int num_failed = 0;
+    for(int i = 0; i < plan->num_ranges; i++) {
+        mps_range_t *r = &plan->ranges[i];
+        if(r->data) {
+            continue; // already loaded
+        }
+        // one spare byte, the decoder reads a whole record even for an odd length image
+        if(NULL == (r->data = calloc(1, (size_t)r->len + 1))) {
+            num_failed++;
+            continue;
+        }
+        if((0 != fseek(fp, r->offset, SEEK_SET)) || ((r->len) && (1 != fread(r->data, r->len, 1, fp)))) {
+            free_s(r->data);
+            num_failed++;
+        }
+    }
+    return num_failed;
+}
+
+int mps_plan_image(const mps_plan_t *plan, int index, memstream_buf_t *dst) {
+    if((index < 0) || (index >= plan->count) || (plan->range[index] < 0)) {
+        return -1;
+    }
+    const mps_range_t *r = &plan->ranges[plan->range[index]];
+    if(NULL == r->data) {
+        return -1;
+    }
+    memstream_buf_t src = {plan->len[index], 0, &r->data[plan->offset[index] - r->offset]};
+    return rle_decompress(dst, &src);
+}
+
+void mps_plan_free(mps_plan_t *plan) {
+    if(NULL == plan) {
+        return;
+    }
+    for(int i = 0; i < plan->num_ranges; i++) {
+        free_s(plan->ranges[i].data);
+    }
+    free_s(plan->range);
+    free_s(plan->offset);
+    free_s(plan->len);
+    free_s(plan->ranges);
+    free(plan);
+}
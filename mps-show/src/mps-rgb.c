@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mps-rgb.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define PAL8(c) ((uint8_t)(((c) * 255) / 63))  // 6 bit component to 8 bits, as pal6_to_pal8()
+
+void mps_rgb_lut32(uint32_t *lut, const pal_entry_t *pal) {
+    for(int i = 0; i < 256; i++) {
+        uint8_t c[4] = {PAL8(pal[i].r), PAL8(pal[i].g), PAL8(pal[i].b), 255};
+        memcpy(&lut[i], c, sizeof(c));
+    }
+}
+
+void mps_rgb_lut565(uint16_t *lut, const pal_entry_t *pal) {
+    for(int i = 0; i < 256; i++) {
+        lut[i] = (uint16_t)(((PAL8(pal[i].r) >> 3) << 11) | ((PAL8(pal[i].g) >> 2) << 5) | (PAL8(pal[i].b) >> 3));
+    }
+}
+
+// run fill kernels, each writes 'n' copies of a pixel
+
+static void fill32(uint8_t *dst, uint32_t pix, int n) {
+    int x = 0;
+#if defined(__AVX2__)
+    __m256i v = _mm256_set1_epi32((int)pix);
+    for(; (x + 8) <= n; x += 8) {
+        _mm256_storeu_si256((__m256i *)&dst[x * 4], v);
+    }
+#elif defined(__SSE2__)
+    __m128i v = _mm_set1_epi32((int)pix);
+    for(; (x + 4) <= n; x += 4) {
+        _mm_storeu_si128((__m128i *)&dst[x * 4], v);
+    }
+#elif defined(__ARM_NEON)
+    uint32x4_t v = vdupq_n_u32(pix);
+    for(; (x + 4) <= n; x += 4) {
+        vst1q_u32((uint32_t *)&dst[x * 4], v);
+    }
+#endif
+    for(; x < n; x++) {
+        memcpy(&dst[x * 4], &pix, 4);
+    }
+}
+
+static void fill16(uint8_t *dst, uint16_t pix, int n) {
+    int x = 0;
+#if defined(__AVX2__)
+    __m256i v = _mm256_set1_epi16((short)pix);
+    for(; (x + 16) <= n; x += 16) {
+        _mm256_storeu_si256((__m256i *)&dst[x * 2], v);
+    }
+#elif defined(__SSE2__)
+    __m128i v = _mm_set1_epi16((short)pix);
+    for(; (x + 8) <= n; x += 8) {
+        _mm_storeu_si128((__m128i *)&dst[x * 2], v);
+    }
+#elif defined(__ARM_NEON)
+    uint16x8_t v = vdupq_n_u16(pix);
+    for(; (x + 8) <= n; x += 8) {
+        vst1q_u16((uint16_t *)&dst[x * 2], v);
+    }
+#endif
+    for(; x < n; x++) {
+        memcpy(&dst[x * 2], &pix, 2);
+    }
+}
+
+static void fill24(uint8_t *dst, const uint8_t *rgb, int n) {
+    int x = 0;
+#if defined(__SSE2__)
+    // 16 pixels are exactly three vectors, so the pattern repeats every 48 bytes
+    if(n >= 16) {
+        uint8_t pat[48];
+        for(int i = 0; i < 16; i++) {
+            memcpy(&pat[i * 3], rgb, 3);
+        }
+        __m128i v0 = _mm_loadu_si128((const __m128i *)&pat[0]);
+        __m128i v1 = _mm_loadu_si128((const __m128i *)&pat[16]);
+        __m128i v2 = _mm_loadu_si128((const __m128i *)&pat[32]);
+        for(; (x + 16) <= n; x += 16) {
+            _mm_storeu_si128((__m128i *)&dst[x * 3], v0);
+            _mm_storeu_si128((__m128i *)&dst[x * 3 + 16], v1);
+            _mm_storeu_si128((__m128i *)&dst[x * 3 + 32], v2);
+        }
+    }
+#elif defined(__ARM_NEON)
+    uint8x16x3_t v = {{vdupq_n_u8(rgb[0]), vdupq_n_u8(rgb[1]), vdupq_n_u8(rgb[2])}};
+    for(; (x + 16) <= n; x += 16) {
+        vst3q_u8(&dst[x * 3], v);
+    }
+#endif
+    for(; x < n; x++) {
+        dst[x * 3 + 0] = rgb[0];
+        dst[x * 3 + 1] = rgb[1];
+        dst[x * 3 + 2] = rgb[2];
+    }
+}
+
+/// @brief clips a run to the space left in the destination
+/// @return the number of pixels of the run that fit
+static int run_fit(memstream_buf_t *dst, int count, int bpp) {
+    size_t avail = (dst->len - dst->pos) / bpp;
+    return ((size_t)count > avail) ? (int)avail : count;
+}
+
+int rle_decompress_rgba32(memstream_buf_t *dst, memstream_buf_t *src, const pal_entry_t *pal) {
+    uint32_t lut[256];
+    mps_rgb_lut32(lut, pal);
+
+    while((src->pos + 2) <= src->len) {
+        int count = src->data[src->pos++];
+        int pix = src->data[src->pos++];
+        int n = run_fit(dst, count, 4);
+        fill32(&dst->data[dst->pos], lut[pix], n);
+        dst->pos += (size_t)n * 4;
+        // check for destination overflow
+        if(n < count) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int rle_decompress_rgb24(memstream_buf_t *dst, memstream_buf_t *src, const pal_entry_t *pal) {
+    uint8_t lut[256][3];
+    for(int i = 0; i < 256; i++) {
+        lut[i][0] = PAL8(pal[i].r);
+        lut[i][1] = PAL8(pal[i].g);
+        lut[i][2] = PAL8(pal[i].b);
+    }
+
+    while((src->pos + 2) <= src->len) {
+        int count = src->data[src->pos++];
+        int pix = src->data[src->pos++];
+        int n = run_fit(dst, count, 3);
+        fill24(&dst->data[dst->pos], lut[pix], n);
+        dst->pos += (size_t)n * 3;
+        // check for destination overflow
+        if(n < count) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int rle_decompress_rgb565(memstream_buf_t *dst, memstream_buf_t *src, const pal_entry_t *pal) {
+    uint16_t lut[256];
+    mps_rgb_lut565(lut, pal);
+
+    while((src->pos + 2) <= src->len) {
+        int count = src->data[src->pos++];
+        int pix = src->data[src->pos++];
+        int n = run_fit(dst, count, 2);
+        fill16(&dst->data[dst->pos], lut[pix], n);
+        dst->pos += (size_t)n * 2;
+        // check for destination overflow
+        if(n < count) {
+            return -1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,44 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mps-ring.h"
+
+/// @brief fills in the rest of a slot once its image has been decoded
+static void ring_fill(mps_ring_slot_t *slot, const info_t *slide, uint32_t index, size_t len) {
+    if(len < MPS_RING_FRAMESZ) {
+        memset(&slot->pixels[len], 0, MPS_RING_FRAMESZ - len);
+    }
+    slot->slide = index;
+    slot->len = (uint32_t)len;
+    int name_len = (slide->name_len < sizeof(slide->name)) ? slide->name_len : sizeof(slide->name);
+    memset(slot->name, 0, sizeof(slot->name));
+    memcpy(slot->name, slide->name, name_len);
+    memcpy(slot->pal, slide->pal, sizeof(slot->pal));
+}
+
+int mps_ring_put_image(mps_ring_t *ring, FILE *fp, info_t *slide, uint32_t index) {
+    mps_ring_slot_t *slot = mps_ring_begin(ring);
+
+    // the image is decoded straight into the shared memory
+    memstream_buf_t dst = {MPS_RING_FRAMESZ, 0, slot->pixels};
+    if(0 != read_mps_show_image(&dst, fp, slide)) {
+        mps_ring_abort(ring);
+        return -1;
+    }
+    ring_fill(slot, slide, index, dst.pos);
+    mps_ring_commit(ring);
+    return 0;
+}
+
+int mps_ring_put_image_fd(mps_ring_t *ring, int fd, const info_t *slide, uint32_t index) {
+    mps_ring_slot_t *slot = mps_ring_begin(ring);
+
+    memstream_buf_t dst = {MPS_RING_FRAMESZ, 0, slot->pixels};
+    if(0 != read_mps_show_image_fd(&dst, fd, slide)) {
+        mps_ring_abort(ring);
+        return -1;
+    }
+    ring_fill(slot, slide, index, dst.pos);
+    mps_ring_commit(ring);
+    return 0;
+}
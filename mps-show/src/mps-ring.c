@@ -0,0 +1,262 @@
+#if defined(__linux__)
+#define _GNU_SOURCE     // for memfd_create()
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mps-ring.h"
+
+#define RING_POLL_NS (100000)   // time to sleep between checks while waiting, 0.1ms
+
+/// @brief total size of the shared memory for a ring
+static size_t ring_size(uint32_t num_slots) {
+    return sizeof(mps_ring_hdr_t) + (size_t)num_slots * sizeof(mps_ring_slot_t);
+}
+
+static void ring_nap(void) {
+    struct timespec ts = {0, RING_POLL_NS};
+    nanosleep(&ts, NULL);
+}
+
+/// @brief maps a ring's shared memory
+/// @param fd the open descriptor
+/// @param size size of the ring, or 0 to take it from the descriptor
+/// @return pointer to the ring, NULL on failure
+static mps_ring_t *ring_map(int fd, size_t size) {
+    mps_ring_t *ring = NULL;
+    void *mem = MAP_FAILED;
+
+    // the counters are shared between processes, so they must not need a lock
+    _Atomic uint64_t probe;
+    if(!atomic_is_lock_free(&probe)) {
+        return NULL;
+    }
+    if(0 == size) {
+        struct stat st;
+        if((0 != fstat(fd, &st)) || (st.st_size < (off_t)sizeof(mps_ring_hdr_t))) {
+            return NULL;
+        }
+        size = st.st_size;
+    }
+    if(MAP_FAILED == (mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0))) {
+        return NULL;
+    }
+    if(NULL == (ring = calloc(1, sizeof(mps_ring_t)))) {
+        munmap(mem, size);
+        return NULL;
+    }
+    ring->fd = fd;
+    ring->size = size;
+    ring->hdr = mem;
+    ring->slots = (uint8_t *)mem + sizeof(mps_ring_hdr_t);
+    return ring;
+}
+
+mps_ring_t *mps_ring_create(const char *name, int num_slots, uint32_t flags) {
+    mps_ring_t *ring = NULL;
+    int fd = -1;
+
+    if(num_slots < 1) {
+        return NULL;
+    }
+    if(name) {
+        fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    } else {
+#if defined(__linux__)
+        fd = memfd_create("mps-ring", 0);
+#else
+        errno = ENOTSUP;
+#endif
+    }
+    if(fd < 0) {
+        return NULL;
+    }
+
+    // the new memory reads as zeros, so every slot starts out empty
+    size_t size = ring_size(num_slots);
+    if((0 != ftruncate(fd, size)) || (NULL == (ring = ring_map(fd, size)))) {
+        goto FAILED;
+    }
+    if(name && (NULL == (ring->name = strdup(name)))) {
+        goto FAILED;
+    }
+    ring->owner = true;
+
+    mps_ring_hdr_t *hdr = ring->hdr;
+    hdr->num_slots = num_slots;
+    hdr->slot_size = sizeof(mps_ring_slot_t);
+    hdr->flags = flags;
+    atomic_store(&hdr->head, 0);
+    atomic_store(&hdr->tail, 0);
+    atomic_store(&hdr->closed, 0);
+    hdr->version = MPS_RING_VERSION;
+    // consumers check this last, so they never see a partly set up ring
+    atomic_thread_fence(memory_order_release);
+    hdr->magic = MPS_RING_MAGIC;
+    return ring;
+
+FAILED:
+    if(ring) {
+        ring->owner = false; // the name is removed below
+        mps_ring_close(ring);
+    } else {
+        close(fd);
+    }
+    if(name) {
+        shm_unlink(name);
+    }
+    return NULL;
+}
+
+mps_ring_t *mps_ring_open_fd(int fd) {
+    mps_ring_t *ring = NULL;
+
+    if(NULL == (ring = ring_map(fd, 0))) {
+        return NULL;
+    }
+    mps_ring_hdr_t *hdr = ring->hdr;
+    if((MPS_RING_MAGIC != hdr->magic) || (MPS_RING_VERSION != hdr->version) ||
+       (sizeof(mps_ring_slot_t) != hdr->slot_size) || (0 == hdr->num_slots) ||
+       (ring->size < ring_size(hdr->num_slots))) {
+        ring->fd = -1; // the caller still owns the descriptor
+        mps_ring_close(ring);
+        return NULL;
+    }
+    atomic_thread_fence(memory_order_acquire);
+    return ring;
+}
+
+mps_ring_t *mps_ring_open(const char *name) {
+    mps_ring_t *ring = NULL;
+    int fd = -1;
+
+    if((fd = shm_open(name, O_RDWR, 0)) < 0) {
+        return NULL;
+    }
+    if(NULL == (ring = mps_ring_open_fd(fd))) {
+        close(fd);
+    }
+    return ring;
+}
+
+void mps_ring_close(mps_ring_t *ring) {
+    if(NULL == ring) {
+        return;
+    }
+    if(ring->hdr) {
+        munmap(ring->hdr, ring->size);
+    }
+    if(ring->fd >= 0) {
+        close(ring->fd);
+    }
+    if(ring->owner && ring->name) {
+        shm_unlink(ring->name);
+    }
+    free(ring->name);
+    free(ring);
+}
+
+mps_ring_slot_t *mps_ring_begin(mps_ring_t *ring) {
+    mps_ring_hdr_t *hdr = ring->hdr;
+    uint64_t n = atomic_load_explicit(&hdr->head, memory_order_relaxed);
+
+    // wait for the consumer to finish with the frame that was in the slot
+    if(hdr->flags & MPS_RING_WAIT) {
+        while((n - atomic_load_explicit(&hdr->tail, memory_order_acquire)) >= hdr->num_slots) {
+            ring_nap();
+        }
+    }
+
+    // mark the slot as being written before any of it changes
+    mps_ring_slot_t *slot = mps_ring_slot(ring, n);
+    atomic_store_explicit(&slot->seq, 2 * n + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    return slot;
+}
+
+void mps_ring_commit(mps_ring_t *ring) {
+    mps_ring_hdr_t *hdr = ring->hdr;
+    uint64_t n = atomic_load_explicit(&hdr->head, memory_order_relaxed);
+    atomic_store_explicit(&mps_ring_slot(ring, n)->seq, 2 * n + 2, memory_order_release);
+    atomic_store_explicit(&hdr->head, n + 1, memory_order_release);
+}
+
+void mps_ring_abort(mps_ring_t *ring) {
+    uint64_t n = atomic_load_explicit(&ring->hdr->head, memory_order_relaxed);
+    // the old frame in the slot is gone, so it is left holding no frame at all
+    atomic_store_explicit(&mps_ring_slot(ring, n)->seq, 0, memory_order_release);
+}
+
+void mps_ring_end(mps_ring_t *ring) {
+    atomic_store_explicit(&ring->hdr->closed, 1, memory_order_release);
+}
+
+int mps_ring_wait(const mps_ring_t *ring, uint64_t n, int timeout_ms) {
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for(;;) {
+        if(n < mps_ring_head(ring)) {
+            return MPS_RING_READY;
+        }
+        if(atomic_load_explicit(&ring->hdr->closed, memory_order_acquire)) {
+            // a last frame may have been published just before the close
+            return (n < mps_ring_head(ring)) ? MPS_RING_READY : MPS_RING_END;
+        }
+        if(timeout_ms >= 0) {
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            long ms = (t1.tv_sec - t0.tv_sec) * 1000 + (t1.tv_nsec - t0.tv_nsec) / 1000000;
+            if(ms >= timeout_ms) {
+                return MPS_RING_EMPTY;
+            }
+        }
+        ring_nap();
+    }
+}
+
+int mps_ring_peek(const mps_ring_t *ring, uint64_t n, const mps_ring_slot_t **slot) {
+    const mps_ring_slot_t *s = mps_ring_slot(ring, n);
+    // the head is read first, so if it says frame 'n' was written, the slot shows it too
+    uint64_t head = mps_ring_head(ring);
+    uint64_t seq = atomic_load_explicit(&s->seq, memory_order_acquire);
+
+    *slot = NULL;
+    if((2 * n + 2) == seq) {
+        *slot = s;
+        return MPS_RING_READY;
+    }
+    if(((2 * n + 2) < seq) || (n < head)) {
+        return MPS_RING_OVERRUN; // a later frame has taken the slot
+    }
+    if(atomic_load_explicit(&ring->hdr->closed, memory_order_acquire) && (n >= mps_ring_head(ring))) {
+        return MPS_RING_END;
+    }
+    return MPS_RING_EMPTY;
+}
+
+int mps_ring_check(const mps_ring_t *ring, uint64_t n) {
+    // make sure all the reads of the frame happen before the sequence is checked again
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t seq = atomic_load_explicit(&mps_ring_slot(ring, n)->seq, memory_order_relaxed);
+    return ((2 * n + 2) == seq) ? MPS_RING_READY : MPS_RING_OVERRUN;
+}
+
+int mps_ring_read(const mps_ring_t *ring, uint64_t n, uint8_t *pixels, pal_entry_t *pal) {
+    const mps_ring_slot_t *slot = NULL;
+    int state = mps_ring_peek(ring, n, &slot);
+    if(MPS_RING_READY != state) {
+        return state;
+    }
+    memcpy(pixels, slot->pixels, MPS_RING_FRAMESZ);
+    memcpy(pal, slot->pal, sizeof(slot->pal));
+    return mps_ring_check(ring, n);
+}
+
+void mps_ring_release(mps_ring_t *ring, uint64_t n) {
+    atomic_store_explicit(&ring->hdr->tail, n + 1, memory_order_release);
+}
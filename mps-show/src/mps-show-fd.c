@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include "mps-show.h"
+#include "util.h"
+
+/// @brief reads exactly 'len' bytes at 'offset', retrying short and interrupted reads
+/// @return 0 on success, -1 on error or if the end of file was reached
+static int pread_full(int fd, void *buf, size_t len, off_t offset) {
+    uint8_t *p = buf;
+    while(len) {
+        ssize_t nr = pread(fd, p, len, offset);
+        if(nr < 0) {
+            if(EINTR == errno) continue;
+            return -1;
+        }
+        if(0 == nr) { // unexpected end of file
+            return -1;
+        }
+        p += nr;
+        len -= nr;
+        offset += nr;
+    }
+    return 0;
+}
+
+info_t *read_mps_show_info_header_fd(int fd, int *count) {
+    info_t *slide_info = NULL;
+    uint8_t num_slides = 0;
+
+    if((0 != pread_full(fd, &num_slides, 1, 0)) || (0 == num_slides)) {
+        return NULL;
+    }
+
+    // allocate the buffer for the all the slide records
+    if(NULL == (slide_info = (info_t *)calloc(num_slides, sizeof(info_t)))) {
+        return NULL;
+    }
+
+    if(0 != pread_full(fd, slide_info, sizeof(info_t) * num_slides, 1)) {
+        free(slide_info);
+        return NULL;
+    }
+
+    *count = num_slides;
+    return slide_info;
+}
+
+int read_mps_show_rle_at_fd(memstream_buf_t *src, int fd, uint32_t offset, uint32_t len) {
+    src->len = 0;
+    src->pos = 0;
+
+    // allocate our input buffer
+    if(NULL == (src->data = calloc(1, len))) {
+        return -1;
+    }
+
+    // read in the compressed data, straight from its position in the file
+    if(0 != pread_full(fd, src->data, len, offset)) {
+        free_s(src->data);
+        return -1;
+    }
+    src->len = len;
+    return 0;
+}
+
+int read_mps_show_rle_fd(memstream_buf_t *src, int fd, const info_t *slide) {
+    return read_mps_show_rle_at_fd(src, fd, slide->img_offset, slide->img_len);
+}
+
+int read_mps_show_image_fd(memstream_buf_t *dst, int fd, const info_t *slide) {
+    int rval = -1;
+    memstream_buf_t src = {0, 0, NULL};
+
+    // read in the compressed data
+    if(0 != read_mps_show_rle_fd(&src, fd, slide)) {
+        goto cleanup;
+    }
+
+    // decompress the image
+    if(0 != rle_decompress(dst, &src)) {
+        goto cleanup;
+    }
+
+    rval = 0;
+cleanup:
+    free_s(src.data);
+    return rval;
+}
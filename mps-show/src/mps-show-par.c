@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "mps-show.h"
+#include "util.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define PAR_BLOCK (4096)            // compressed bytes per block when balancing the work, must be even
+#define PAR_MAX_THREADS (64)
+
+// the part of the stream decoded by one thread
+typedef struct {
+    const uint8_t   *src;       // first record
+    size_t          src_len;    // length of the records
+    uint8_t         *dst;       // where the first record's pixels go
+} par_chunk_t;
+
+/// @brief sums the run counts of a block of records, the even bytes of the block
+/// @param p pointer to the records
+/// @param len length of the records in bytes, must be even
+/// @return the number of pixels the records expand to
+static uint64_t par_count(const uint8_t *p, size_t len) {
+    uint64_t sum = 0;
+    size_t i = 0;
+#if defined(__SSE2__)
+    // mask off the pixel values, then sum the counts 8 at a time
+    const __m128i mask = _mm_set1_epi16(0x00ff);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = zero;
+    for(; (i + 16) <= len; i += 16) {
+        __m128i v = _mm_and_si128(_mm_loadu_si128((const __m128i *)&p[i]), mask);
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(v, zero));
+    }
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i *)lanes, acc);
+    sum = lanes[0] + lanes[1];
+#elif defined(__ARM_NEON)
+    const uint16x8_t mask = vdupq_n_u16(0x00ff);
+    uint32x4_t acc = vdupq_n_u32(0);
+    for(; (i + 16) <= len; i += 16) {
+        uint16x8_t v = vandq_u16(vreinterpretq_u16_u8(vld1q_u8(&p[i])), mask);
+        acc = vpadalq_u16(acc, v);
+    }
+    sum = (uint64_t)vgetq_lane_u32(acc, 0) + vgetq_lane_u32(acc, 1) + vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3);
+#endif
+    for(; i < len; i += 2) {
+        sum += p[i];
+    }
+    return sum;
+}
+
+/// @brief decodes one chunk, the destination has already been checked to be large enough
+static void *par_decode(void *arg) {
+    par_chunk_t *c = arg;
+    uint8_t *dst = c->dst;
+    for(size_t i = 0; i < c->src_len; i += 2) {
+        memset(dst, c->src[i + 1], c->src[i]);
+        dst += c->src[i];
+    }
+    return NULL;
+}
+
+int rle_decompress_parallel(memstream_buf_t *dst, memstream_buf_t *src, int threads) {
+    uint64_t *sums = NULL;
+    size_t len = src->len - src->pos;
+
+    if(threads > PAR_MAX_THREADS) {
+        threads = PAR_MAX_THREADS;
+    }
+    // a partial record needs the serial decoder's handling
+    if((threads < 2) || (src->pos > src->len) || (len & 1) || (len < (2 * PAR_BLOCK))) {
+        return rle_decompress(dst, src);
+    }
+
+    // pixel counts of each block, the prefix sum of these gives each block's output position
+    const uint8_t *data = &src->data[src->pos];
+    size_t num_blocks = (len + PAR_BLOCK - 1) / PAR_BLOCK;
+    if(NULL == (sums = malloc(num_blocks * sizeof(uint64_t)))) {
+        return rle_decompress(dst, src);
+    }
+    uint64_t total = 0;
+    for(size_t b = 0; b < num_blocks; b++) {
+        size_t n = ((b + 1) * PAR_BLOCK > len) ? (len - b * PAR_BLOCK) : PAR_BLOCK;
+        sums[b] = par_count(&data[b * PAR_BLOCK], n);
+        total += sums[b];
+    }
+
+    // too little work to be worth the threads, or it will not fit, where the serial
+    // decoder fills what it can before failing
+    if((total < RLE_PARALLEL_MIN) || (total > (dst->len - dst->pos))) {
+        free(sums);
+        return rle_decompress(dst, src);
+    }
+
+    // split at block boundaries, so each thread has about the same number of pixels to write
+    par_chunk_t chunks[PAR_MAX_THREADS];
+    int num_chunks = 0;
+    uint64_t out = 0;
+    size_t b = 0;
+    for(int t = 0; (t < threads) && (b < num_blocks); t++) {
+        uint64_t target = (total * (t + 1)) / threads;
+        par_chunk_t *c = &chunks[num_chunks++];
+        c->src = &data[b * PAR_BLOCK];
+        c->dst = &dst->data[dst->pos + out];
+        size_t start = b;
+        do {
+            out += sums[b++];
+        } while((b < num_blocks) && (out < target));
+        c->src_len = ((b * PAR_BLOCK > len) ? len : (b * PAR_BLOCK)) - (start * PAR_BLOCK);
+    }
+    free(sums);
+
+    // this thread decodes the first chunk while the others do the rest
+    pthread_t tid[PAR_MAX_THREADS];
+    int started[PAR_MAX_THREADS];
+    for(int t = 1; t < num_chunks; t++) {
+        started[t] = (0 == pthread_create(&tid[t], NULL, par_decode, &chunks[t]));
+    }
+    par_decode(&chunks[0]);
+    for(int t = 1; t < num_chunks; t++) {
+        if(started[t]) {
+            pthread_join(tid[t], NULL);
+        } else {
+            par_decode(&chunks[t]); // could not start a thread, so do it here
+        }
+    }
+
+    src->pos = src->len;
+    dst->pos += total;
+    return 0;
+}
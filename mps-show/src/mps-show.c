@@ -52,23 +52,36 @@ int rle_decompress(memstream_buf_t *dst, memstream_buf_t *src) {
     return 0;
 }
 
-int read_mps_show_image(memstream_buf_t *dst, FILE *fp, info_t *slide) {
-    int rval = -1;
-    memstream_buf_t src = {0, 0, NULL};
+/// @brief Reads in the compressed (RLE) data for the image referenced by 'slide'
+/// @param src pointer to a memstream buffer, its data is allocated by this function
+/// @param fp pointer to an open file with the image data
+/// @param slide pointer to a slide record for the image to load
+/// @return returns 0 on success
+int read_mps_show_rle(memstream_buf_t *src, FILE *fp, info_t *slide) {
+    src->len = 0;
+    src->pos = 0;
 
     // allocate our input buffer
-    if(NULL == (src.data = calloc(1, slide->img_len))) {
-        goto cleanup;
+    if(NULL == (src->data = calloc(1, slide->img_len))) {
+        return -1;
+    }
+    src->len = slide->img_len;
+
+    // goto the image in the file, then read in the compressed data
+    if((0 != fseek(fp, slide->img_offset, SEEK_SET)) || (1 != fread(src->data, src->len, 1, fp))) {
+        free_s(src->data);
+        src->len = 0;
+        return -1;
     }
-    src.len = slide->img_len;
-    src.pos = 0;
+    return 0;
+}
 
-    // goto the image in the file
-    fseek(fp, slide->img_offset, SEEK_SET);
+int read_mps_show_image(memstream_buf_t *dst, FILE *fp, info_t *slide) {
+    int rval = -1;
+    memstream_buf_t src = {0, 0, NULL};
 
     // read in the compressed data
-    int nr = fread(src.data, src.len, 1, fp);
-    if(1 != nr) {
+    if(0 != read_mps_show_rle(&src, fp, slide)) {
         goto cleanup;
     }
 
@@ -82,4 +95,3 @@ cleanup:
     free_s(src.data);
     return rval;
 }
-
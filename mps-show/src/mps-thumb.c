@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "mps-thumb.h"
+#include "util.h"
+
+#define THUMB_MAXW (MPS_WIDTH / 2)  // widest thumbnail we can produce (scale of 2)
+
+// working state for a thumbnail being built up one band of 'scale' source lines at a time
+typedef struct {
+    int         scale;                      // downscale factor
+    int         width;                      // thumbnail width in pixels
+    uint32_t    area;                       // number of source pixels per thumbnail pixel
+    uint8_t     *out;                       // pointer to the next thumbnail line to output
+    uint8_t     lut[256][THUMB_BPP];        // palette converted to 8 bits per component
+    uint32_t    acc[THUMB_MAXW * THUMB_BPP];        // per column RGB sums for the current band
+    uint32_t    dif[(THUMB_MAXW + 1) * THUMB_BPP];  // difference array for runs covering whole columns
+} thumb_state_t;
+
+int thumb_scale_valid(int scale) {
+    return ((2 == scale) || (4 == scale) || (8 == scale));
+}
+
+size_t thumb_size(int scale) {
+    if(!thumb_scale_valid(scale)) {
+        return 0;
+    }
+    return (size_t)(MPS_WIDTH / scale) * (MPS_HEIGHT / scale) * THUMB_BPP;
+}
+
+/// @brief adds 'n' pixels of the given colour to a single thumbnail column
+static inline void thumb_add(uint32_t *acc, int col, const uint8_t *rgb, uint32_t n) {
+    acc[col * THUMB_BPP + 0] += rgb[0] * n;
+    acc[col * THUMB_BPP + 1] += rgb[1] * n;
+    acc[col * THUMB_BPP + 2] += rgb[2] * n;
+}
+
+/// @brief accumulates a horizontal span of a single colour, repeated over 'rows' lines
+/// partial columns at either end are added directly, while the columns fully covered by
+/// the span are added in constant time via the difference array
+static void thumb_span(thumb_state_t *ts, int x, int n, const uint8_t *rgb, uint32_t rows) {
+    int s = ts->scale;
+    int col = x / s;
+
+    if(x % s) { // partial column at the start of the span
+        int k = s - (x % s);
+        if(k > n) k = n;
+        thumb_add(ts->acc, col, rgb, k * rows);
+        n -= k;
+        col++;
+    }
+
+    int full = n / s;
+    if(full) { // whole columns covered by the span
+        uint32_t w = s * rows;
+        for(int i = 0; i < THUMB_BPP; i++) {
+            ts->dif[col * THUMB_BPP + i] += rgb[i] * w;
+            ts->dif[(col + full) * THUMB_BPP + i] -= rgb[i] * w;
+        }
+        col += full;
+        n -= full * s;
+    }
+
+    if(n) { // partial column at the end of the span
+        thumb_add(ts->acc, col, rgb, n * rows);
+    }
+}
+
+/// @brief averages the accumulated band into the next line of the thumbnail, and resets
+/// the accumulators for the next band
+static void thumb_flush(thumb_state_t *ts) {
+    uint32_t run[THUMB_BPP] = {0, 0, 0};
+    uint32_t half = ts->area / 2;
+
+    for(int col = 0; col < ts->width; col++) {
+        for(int i = 0; i < THUMB_BPP; i++) {
+            run[i] += ts->dif[col * THUMB_BPP + i];
+            *ts->out++ = (ts->acc[col * THUMB_BPP + i] + run[i] + half) / ts->area;
+        }
+    }
+    memset(ts->acc, 0, sizeof(ts->acc));
+    memset(ts->dif, 0, sizeof(ts->dif));
+}
+
+int rle_decompress_thumbnail(memstream_buf_t *dst, memstream_buf_t *src, pal_entry_t *pal, int scale) {
+    if((NULL == dst) || (NULL == dst->data) || (NULL == src) || (NULL == pal)) {
+        return -1;
+    }
+    size_t tsz = thumb_size(scale);
+    if((0 == tsz) || ((dst->len - dst->pos) < tsz)) {
+        return -1;
+    }
+
+    thumb_state_t *ts = calloc(1, sizeof(thumb_state_t));
+    if(NULL == ts) {
+        return -1;
+    }
+    ts->scale = scale;
+    ts->width = MPS_WIDTH / scale;
+    ts->area = scale * scale;
+    ts->out = &dst->data[dst->pos];
+
+    // convert from 6-bit/component (VGA) to 8-bit/component, the same as pal6_to_pal8()
+    for(int i = 0; i < 256; i++) {
+        ts->lut[i][0] = (pal[i].r * 255) / 63;
+        ts->lut[i][1] = (pal[i].g * 255) / 63;
+        ts->lut[i][2] = (pal[i].b * 255) / 63;
+    }
+
+    int rval = -1;
+    int x = 0;
+    int y = 0;
+    bool eos = false; // end of stream, remaining pixels are padded with index 0
+    while(!eos) {
+        uint32_t count;
+        int pix;
+        if((src->pos + 1) < src->len) {
+            count = src->data[src->pos++];
+            pix = src->data[src->pos++];
+        } else {
+            eos = true;
+            count = (uint32_t)(MPS_HEIGHT - y) * MPS_WIDTH - x;
+            pix = 0;
+        }
+
+        while(count) {
+            if(y >= MPS_HEIGHT) { // more data than fits in the image
+                goto cleanup;
+            }
+            if((0 == x) && (count >= MPS_WIDTH)) {
+                // run covers one or more entire lines, add them all at once, up to the end of the band
+                uint32_t rows = count / MPS_WIDTH;
+                uint32_t band = scale - (y % scale);
+                if(rows > band) rows = band;
+                thumb_span(ts, 0, MPS_WIDTH, ts->lut[pix], rows);
+                y += rows;
+                count -= rows * MPS_WIDTH;
+            } else {
+                int n = MPS_WIDTH - x;
+                if((uint32_t)n > count) n = count;
+                thumb_span(ts, x, n, ts->lut[pix], 1);
+                x += n;
+                count -= n;
+                if(MPS_WIDTH == x) {
+                    x = 0;
+                    y++;
+                }
+            }
+            if((0 == x) && (0 == (y % scale))) { // completed a band
+                thumb_flush(ts);
+            }
+        }
+    }
+    dst->pos += tsz;
+    rval = 0;
+
+cleanup:
+    free_s(ts);
+    return rval;
+}
+
+int read_mps_show_thumbnail(memstream_buf_t *dst, FILE *fp, info_t *slide, int scale) {
+    int rval = -1;
+    memstream_buf_t src = {0, 0, NULL};
+
+    // read in the compressed data
+    if(0 != read_mps_show_rle(&src, fp, slide)) {
+        goto cleanup;
+    }
+
+    // decompress and downscale the image
+    if(0 != rle_decompress_thumbnail(dst, &src, slide->pal, scale)) {
+        goto cleanup;
+    }
+
+    rval = 0;
+cleanup:
+    free_s(src.data);
+    return rval;
+}
@@ -119,3 +119,154 @@ bmp_cleanup:
     free_s(buf);
     return rval;
 }
+
+int save_bmp24(const char *fn, memstream_buf_t *src, uint16_t width, uint16_t height) {
+    int rval = 0;
+    FILE *fp = NULL;
+    uint8_t *buf = NULL; // line buffer, also holds header info
+
+    // do some basic error checking on the inputs
+    if((NULL == fn) || (NULL == src) || (NULL == src->data)) {
+        rval = -1;  // NULL pointer error
+        goto bmp_cleanup;
+    }
+
+    // try to open/create output file
+    if(NULL == (fp = fopen(fn,"wb"))) {
+        rval = -2;  // can't open/create output file
+        goto bmp_cleanup;
+    }
+
+    // stride is the bytes per line in the BMP file, which are padded
+    // out to 32 bit boundaries
+    uint32_t line = width * 3;
+    uint32_t stride = ((line + 3) & (~0x0003)); 
+    uint32_t bmp_img_sz = (stride) * height;
+
+    // allocate a buffer to hold the header and a single scanline of data
+    if(NULL == (buf = calloc(1, HDRBUFSZ + stride + 2))) {
+        rval = -3;  // unable to allocate mem
+        goto bmp_cleanup;
+    }
+
+    // signature starts after padding to maintain 32bit alignment for the rest of the header
+    bmp_signature_t *sig = (bmp_signature_t *)&buf[stride + 2];
+
+    // bmp header starts after signature
+    bmp_header_t *bmp = (bmp_header_t *)&buf[stride + 2 + sizeof(bmp_signature_t)];
+
+    // setup the signature and DIB header fields, there is no palette for truecolour
+    *sig = BMPFILESIG;
+    bmp->dib.image_offset = HDRBUFSZ;
+    bmp->dib.file_size = bmp->dib.image_offset + bmp_img_sz;
+
+    // setup the bmi header fields
+    bmp->bmi.header_size = sizeof(bmi_header_t);
+    bmp->bmi.image_width = width;
+    bmp->bmi.image_height = height;
+    bmp->bmi.num_planes = 1;           // always 1
+    bmp->bmi.bits_per_pixel = 24;      // truecolour image
+    bmp->bmi.compression = 0;          // uncompressed
+    bmp->bmi.bitmap_size = bmp_img_sz;
+    bmp->bmi.horiz_res = BMP96DPI;
+    bmp->bmi.vert_res = BMP96DPI;
+    bmp->bmi.num_colors = 0;           // no palette
+    bmp->bmi.important_colors = 0;     // all colours are important
+
+    // write out the header
+    int nr = fwrite(sig, HDRBUFSZ, 1, fp);
+    if(1 != nr) {
+        rval = -4;  // unable to write file
+        goto bmp_cleanup;
+    }
+
+    // output the scanlines from bottom to top, swapping RGB to the BGR order of BMP
+    // start by pointing to start of last line of data
+    uint8_t *px = &src->data[src->len - line];
+    for(int y = 0; y < height; y++) {
+        memset(buf, 0, stride); // zero out the line in the output buffer
+        for(uint32_t x = 0; x < line; x += 3) {
+            buf[x + 0] = px[2];
+            buf[x + 1] = px[1];
+            buf[x + 2] = px[0];
+            px += 3;
+        }
+        nr = fwrite(buf, stride, 1, fp); // write out the line
+        if(1 != nr) {
+            rval = -4;  // unable to write file
+            goto bmp_cleanup;
+        }
+        px -= (line * 2); // move back to start of previous line
+    }
+
+bmp_cleanup:
+    fclose_s(fp);
+    free_s(buf);
+    return rval;
+}
+
+size_t bmp_size(uint16_t width, uint16_t height) {
+    uint32_t stride = ((width + 3) & (~0x0003)); 
+    return HDRBUFSZ + (sizeof(bmp_palette_entry_t) * 256) + ((size_t)stride * height);
+}
+
+int encode_bmp(memstream_buf_t *dst, memstream_buf_t *src, uint16_t width, uint16_t height, pal_entry_t *xpal) {
+    // do some basic error checking on the inputs
+    if((NULL == dst) || (NULL == dst->data) || (NULL == src) || (NULL == src->data) || (NULL == xpal)) {
+        return -1;  // NULL pointer error
+    }
+    size_t fsz = bmp_size(width, height);
+    if((dst->len - dst->pos) < fsz) {
+        return -3;  // not enough room in the buffer
+    }
+
+    uint32_t stride = ((width + 3) & (~0x0003)); 
+    uint32_t bmp_img_sz = (stride) * height;
+    size_t palsz = sizeof(bmp_palette_entry_t) * 256;
+    uint8_t *out = &dst->data[dst->pos];
+    memset(out, 0, fsz);
+
+    // setup the signature and DIB header fields, the header is assembled on the
+    // stack to keep the fields aligned, then copied into place
+    bmp_signature_t sig = BMPFILESIG;
+    bmp_header_t bmp;
+    memset(&bmp, 0, sizeof(bmp));
+    bmp.dib.image_offset = HDRBUFSZ + palsz;
+    bmp.dib.file_size = bmp.dib.image_offset + bmp_img_sz;
+
+    // setup the bmi header fields
+    bmp.bmi.header_size = sizeof(bmi_header_t);
+    bmp.bmi.image_width = width;
+    bmp.bmi.image_height = height;
+    bmp.bmi.num_planes = 1;           // always 1
+    bmp.bmi.bits_per_pixel = 8;       // 256 colour image
+    bmp.bmi.compression = 0;          // uncompressed
+    bmp.bmi.bitmap_size = bmp_img_sz;
+    bmp.bmi.horiz_res = BMP96DPI;
+    bmp.bmi.vert_res = BMP96DPI;
+    bmp.bmi.num_colors = 256;         // palette has 256 colours
+    bmp.bmi.important_colors = 0;     // all colours are important
+
+    memcpy(out, &sig, sizeof(sig));
+    memcpy(&out[sizeof(sig)], &bmp, sizeof(bmp));
+
+    // copy the external RGB palette to the BMP BGRA palette
+    bmp_palette_entry_t *pal = (bmp_palette_entry_t *)&out[HDRBUFSZ];
+    for(int i = 0; i < 256; i++) {
+        pal[i].r = xpal[i].r;
+        pal[i].g = xpal[i].g;
+        pal[i].b = xpal[i].b;
+    }
+
+    // copy the scanlines, bottom to top as for save_bmp()
+    uint8_t *line = &out[bmp.dib.image_offset];
+    uint8_t *px = &src->data[src->len - width];
+    for(int y = 0; y < height; y++) {
+        memcpy(line, px, width);
+        line += stride;
+        px -= width; // move back to start of previous line
+    }
+
+    dst->pos += fsz;
+    return 0;
+}
@@ -0,0 +1,159 @@
+#include <string.h>
+#include "gif.h"
+
+#define LZW_MIN_BITS  (8)             // initial code size for 256 colour pixels
+#define LZW_MAX_BITS  (12)
+#define LZW_MAX_CODE  ((1 << LZW_MAX_BITS) - 1)
+#define LZW_CLEAR     (1 << LZW_MIN_BITS)
+#define LZW_EOI       (LZW_CLEAR + 1)
+#define LZW_HASHSZ    (5003)          // prime, about 80% occupied when the table is full
+
+// state of the LZW encoder, and of the bit packer it writes the codes to
+typedef struct {
+    FILE        *fp;
+    int32_t     key[LZW_HASHSZ];    // prefix code << 8 | pixel, or -1 for an empty slot
+    uint16_t    code[LZW_HASHSZ];   // the code for the string 'key'
+    int         next;               // next code to be assigned
+    int         bits;               // current code size
+    uint32_t    acc;                // bits not yet written
+    int         acc_bits;
+    int         block_len;
+    uint8_t     block[256];         // data sub-block being filled, up to 255 bytes
+} gif_lzw_t;
+
+static void put_u16(uint8_t *p, int v) {
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+}
+
+/// @brief writes out the data sub-block, if it has anything in it
+static void lzw_flush_block(gif_lzw_t *z) {
+    if(z->block_len) {
+        fputc(z->block_len, z->fp);
+        fwrite(z->block, 1, z->block_len, z->fp);
+        z->block_len = 0;
+    }
+}
+
+/// @brief adds a code, at the current code size, to the output, least significant bit first
+static void lzw_put(gif_lzw_t *z, int code) {
+    z->acc |= (uint32_t)code << z->acc_bits;
+    z->acc_bits += z->bits;
+    while(z->acc_bits >= 8) {
+        z->block[z->block_len++] = z->acc & 0xff;
+        z->acc >>= 8;
+        z->acc_bits -= 8;
+        if(255 == z->block_len) {
+            lzw_flush_block(z);
+        }
+    }
+}
+
+/// @brief empties the string table, back to just the single pixel strings
+static void lzw_reset(gif_lzw_t *z) {
+    memset(z->key, 0xff, sizeof(z->key));
+    z->next = LZW_EOI + 1;
+    z->bits = LZW_MIN_BITS + 1;
+}
+
+/// @brief LZW compresses a rectangle of pixels into data sub-blocks. Strings are looked up
+/// in an open addressed hash table keyed on the prefix code and the next pixel, so the
+/// table is never searched
+static void lzw_encode(gif_lzw_t *z, const uint8_t *pixels, int stride, int w, int h) {
+    z->acc = 0;
+    z->acc_bits = 0;
+    z->block_len = 0;
+    lzw_reset(z);
+    lzw_put(z, LZW_CLEAR);
+
+    int prefix = pixels[0];
+    int x = 1;
+    for(int y = 0; y < h; y++, x = 0) {
+        const uint8_t *row = &pixels[(size_t)y * stride];
+        for(; x < w; x++) {
+            int pix = row[x];
+            int32_t key = (prefix << 8) | pix;
+            int slot = (int)((((uint32_t)pix << 12) ^ prefix) % LZW_HASHSZ);
+            while((z->key[slot] >= 0) && (z->key[slot] != key)) {
+                if(++slot == LZW_HASHSZ) slot = 0;
+            }
+            if(z->key[slot] == key) { // the string continues
+                prefix = z->code[slot];
+                continue;
+            }
+
+            // write the longest string found, and add it plus this pixel to the table
+            lzw_put(z, prefix);
+            z->key[slot] = key;
+            z->code[slot] = z->next;
+            if(z->next >= (1 << z->bits)) { // the decoder will now need wider codes
+                z->bits++;
+            }
+            if(LZW_MAX_CODE == z->next) { // table full, start again
+                lzw_put(z, LZW_CLEAR);
+                lzw_reset(z);
+            } else {
+                z->next++;
+            }
+            prefix = pix;
+        }
+    }
+    lzw_put(z, prefix);
+    lzw_put(z, LZW_EOI);
+    if(z->acc_bits) {
+        z->block[z->block_len++] = z->acc & 0xff;
+    }
+    lzw_flush_block(z);
+    fputc(0, z->fp); // block terminator
+}
+
+int gif_write_header(FILE *fp, int width, int height, int loops) {
+    uint8_t hdr[13] = {'G', 'I', 'F', '8', '9', 'a'};
+    put_u16(&hdr[6], width);
+    put_u16(&hdr[8], height);
+    hdr[10] = 0x70; // no global colour table, 8 bits of colour resolution
+    hdr[11] = 0;    // background colour
+    hdr[12] = 0;    // square pixels
+    if(sizeof(hdr) != fwrite(hdr, 1, sizeof(hdr), fp)) {
+        return -1;
+    }
+
+    if(GIF_LOOP_NONE != loops) {
+        uint8_t ext[19] = {0x21, 0xff, 11, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 3, 1};
+        put_u16(&ext[16], loops);
+        ext[18] = 0;
+        if(sizeof(ext) != fwrite(ext, 1, sizeof(ext), fp)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int gif_write_frame(FILE *fp, const uint8_t *pixels, int stride, int x, int y, int w, int h,
+                    const pal_entry_t *pal, int delay) {
+    gif_lzw_t z;
+    uint8_t gce[8] = {0x21, 0xf9, 4, 0x04, 0, 0, 0, 0}; // do not dispose, no transparency
+    put_u16(&gce[4], delay);
+    uint8_t desc[10] = {0x2c};
+    put_u16(&desc[1], x);
+    put_u16(&desc[3], y);
+    put_u16(&desc[5], w);
+    put_u16(&desc[7], h);
+    desc[9] = 0x87; // local colour table of 256 entries, not interlaced
+
+    if((w < 1) || (h < 1)) {
+        return -1;
+    }
+    fwrite(gce, 1, sizeof(gce), fp);
+    fwrite(desc, 1, sizeof(desc), fp);
+    fwrite(pal, sizeof(pal_entry_t), 256, fp);
+    fputc(LZW_MIN_BITS, fp);
+    z.fp = fp;
+    lzw_encode(&z, &pixels[(size_t)y * stride + x], stride, w, h);
+    return ferror(fp) ? -1 : 0;
+}
+
+int gif_write_end(FILE *fp) {
+    fputc(0x3b, fp);
+    return ferror(fp) ? -1 : 0;
+}
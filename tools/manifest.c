@@ -0,0 +1,451 @@
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <sys/stat.h>
+#include "manifest.h"
+#include "crc32c.h"
+#include "util.h"
+
+#define LINESZ (4096)
+#define CRCBUFSZ (64 * 1024)  // size of the buffer used to read a file for its CRC
+#define MIN_INDEX (64)          // smallest number of slots in an index
+
+// gets the name of record 'i' in a list, for the indexes
+typedef const char *(*name_fn_t)(const void *list, int i);
+
+static const char *input_name(const void *list, int i) {
+    return ((const manifest_input_t *)list)[i].input.name;
+}
+
+static const char *output_name(const void *list, int i) {
+    return ((const manifest_entry_t *)list)[i].name;
+}
+
+/// @brief FNV-1a hash of a name
+static uint32_t name_hash(const char *name) {
+    uint32_t h = 2166136261u;
+    for(const uint8_t *p = (const uint8_t *)name; *p; p++) {
+        h = (h ^ *p) * 16777619u;
+    }
+    return h;
+}
+
+/// @brief finds the slot holding a name, or the empty slot it would go in
+static int index_slot(const manifest_index_t *ix, const void *list, name_fn_t name_of, const char *name) {
+    int mask = ix->size - 1;
+    int s = (int)(name_hash(name) & (uint32_t)mask);
+    while((ix->slots[s]) && (0 != strcmp(name_of(list, ix->slots[s] - 1), name))) {
+        s = (s + 1) & mask;
+    }
+    return s;
+}
+
+/// @brief finds a record by name
+/// @return its index in the list, or -1 if there is none
+static int index_find(const manifest_index_t *ix, const void *list, name_fn_t name_of, const char *name) {
+    if(0 == ix->size) {
+        return -1;
+    }
+    return ix->slots[index_slot(ix, list, name_of, name)] - 1;
+}
+
+/// @brief adds record 'idx' of a list to its index, the records before it must all be
+/// in the index already, it is rebuilt larger when it would be over half full
+static int index_add(manifest_index_t *ix, const void *list, name_fn_t name_of, int idx) {
+    if((idx + 1) * 2 > ix->size) {
+        int size = (ix->size) ? ix->size * 2 : MIN_INDEX;
+        int *slots = calloc(size, sizeof(int));
+        if(NULL == slots) {
+            return -1;
+        }
+        free_s(ix->slots);
+        ix->slots = slots;
+        ix->size = size;
+        for(int i = 0; i < idx; i++) {
+            ix->slots[index_slot(ix, list, name_of, name_of(list, i))] = i + 1;
+        }
+    }
+    ix->slots[index_slot(ix, list, name_of, name_of(list, idx))] = idx + 1;
+    return 0;
+}
+
+/// @brief empties an index, keeping its slots
+static void index_clear(manifest_index_t *ix) {
+    if(ix->slots) {
+        memset(ix->slots, 0, ix->size * sizeof(int));
+    }
+}
+
+/// @brief releases an index
+static void index_free(manifest_index_t *ix) {
+    free_s(ix->slots);
+    ix->size = 0;
+}
+
+/// @brief checks two records are for the same file, with the same identity
+static bool manifest_same(const manifest_entry_t *a, const manifest_entry_t *b) {
+    return (a->size == b->size) && (a->mtime == b->mtime) && (a->crc == b->crc);
+}
+
+/// @brief appends a record to the manifest file
+static int manifest_write(FILE *fp, char type, const manifest_entry_t *e) {
+    fprintf(fp, "%c %" PRIu64 " %" PRId64 " %08x %s\n", type, e->size, e->mtime, e->crc, e->name);
+    return ferror(fp) ? -1 : 0;
+}
+
+/// @brief sets a record, taking a copy of its name
+static int manifest_copy(manifest_entry_t *dst, const manifest_entry_t *src) {
+    char *name = strdup(src->name);
+    if(NULL == name) {
+        return -1;
+    }
+    free_s(dst->name);
+    *dst = *src;
+    dst->name = name;
+    return 0;
+}
+
+/// @brief drops all the output records of an input
+static void manifest_clear(manifest_input_t *in) {
+    for(int i = 0; i < in->num_outputs; i++) {
+        free_s(in->outputs[i].name);
+    }
+    in->num_outputs = 0;
+    index_clear(&in->index);
+}
+
+/// @brief releases all the records
+static void manifest_free(manifest_t *man) {
+    for(int i = 0; i < man->num_inputs; i++) {
+        manifest_clear(&man->inputs[i]);
+        free_s(man->inputs[i].outputs);
+        free_s(man->inputs[i].input.name);
+        index_free(&man->inputs[i].index);
+    }
+    free_s(man->inputs);
+    free_s(man->fn);
+    index_free(&man->index);
+    man->num_inputs = 0;
+    man->cur = -1;
+    man->last = -1;
+}
+
+/// @brief finds an input by name
+/// @return its index, or -1 if there is none
+static int manifest_lookup(const manifest_t *man, const char *name) {
+    return index_find(&man->index, man->inputs, input_name, name);
+}
+
+/// @brief sets an input record in memory, without writing it to the file
+/// @return its index, or -1 on failure
+static int manifest_put_input(manifest_t *man, const manifest_entry_t *input) {
+    int idx = manifest_lookup(man, input->name);
+    if(idx < 0) {
+        if(man->num_inputs == man->max_inputs) {
+            int max = (man->max_inputs) ? man->max_inputs * 2 : 16;
+            manifest_input_t *in = realloc(man->inputs, max * sizeof(manifest_input_t));
+            if(NULL == in) {
+                return -1;
+            }
+            man->inputs = in;
+            man->max_inputs = max;
+        }
+        idx = man->num_inputs;
+        memset(&man->inputs[idx], 0, sizeof(manifest_input_t));
+        if(0 != manifest_copy(&man->inputs[idx].input, input)) {
+            return -1;
+        }
+        if(0 != index_add(&man->index, man->inputs, input_name, idx)) {
+            free_s(man->inputs[idx].input.name);
+            return -1;
+        }
+        man->num_inputs++;
+        return idx;
+    }
+    return (0 == manifest_copy(&man->inputs[idx].input, input)) ? idx : -1;
+}
+
+/// @brief sets an output record in memory, without writing it to the file
+/// @return 0 if it was added, 1 if it replaced a record, -1 on failure
+static int manifest_put(manifest_input_t *in, const manifest_entry_t *output) {
+    int idx = index_find(&in->index, in->outputs, output_name, output->name);
+    if(idx >= 0) {
+        return (0 == manifest_copy(&in->outputs[idx], output)) ? 1 : -1;
+    }
+    if(in->num_outputs == in->max_outputs) {
+        int max = (in->max_outputs) ? in->max_outputs * 2 : 256;
+        manifest_entry_t *o = realloc(in->outputs, max * sizeof(manifest_entry_t));
+        if(NULL == o) {
+            return -1;
+        }
+        in->outputs = o;
+        in->max_outputs = max;
+    }
+    memset(&in->outputs[in->num_outputs], 0, sizeof(manifest_entry_t));
+    if(0 != manifest_copy(&in->outputs[in->num_outputs], output)) {
+        return -1;
+    }
+    if(0 != index_add(&in->index, in->outputs, output_name, in->num_outputs)) {
+        free_s(in->outputs[in->num_outputs].name);
+        return -1;
+    }
+    in->num_outputs++;
+    return 0;
+}
+
+/// @brief loads the records from the manifest file
+/// @param partial pointer to a flag, set if the last line was cut short
+/// @return 0 on success, 1 if the file does not exist, -1 on failure
+static int manifest_load(manifest_t *man, const char *fn, bool *partial) {
+    FILE *fp = NULL;
+    char line[LINESZ];
+    int cur = -1;
+
+    memset(man, 0, sizeof(manifest_t));
+    man->cur = -1;
+    man->last = -1;
+    *partial = false;
+    if(NULL == (man->fn = strdup(fn))) {
+        return -1;
+    }
+    if(NULL == (fp = fopen(fn, "r"))) {
+        return 1;
+    }
+
+    // a line cut short by an interrupted run is ignored
+    while(fgets(line, sizeof(line), fp)) {
+        size_t len = strcspn(line, "\r\n");
+        if('\0' == line[len]) {
+            *partial = true;
+            continue;
+        }
+        *partial = false;
+        line[len] = 0;
+        char type;
+        int n = 0;
+        manifest_entry_t e = {NULL, 0, 0, 0};
+        if((4 != sscanf(line, "%c %" SCNu64 " %" SCNd64 " %x %n", &type, &e.size, &e.mtime, &e.crc, &n)) || (0 == n)) {
+            man->changed = true; // not a record, dropped when the file is rewritten
+            continue;
+        }
+        e.name = &line[n];
+        if('I' == type) {
+            // an input seen before replaces its earlier record and outputs
+            if(manifest_lookup(man, e.name) >= 0) {
+                man->changed = true;
+            }
+            if((cur = manifest_put_input(man, &e)) < 0) goto error;
+            manifest_clear(&man->inputs[cur]);
+        } else if(('O' == type) && (cur >= 0)) {
+            int put = manifest_put(&man->inputs[cur], &e);
+            if(put < 0) goto error;
+            if(put > 0) man->changed = true;
+        } else {
+            man->changed = true;
+        }
+    }
+    man->last = cur;
+    fclose_s(fp);
+    return 0;
+
+error:
+    fclose_s(fp);
+    manifest_free(man);
+    return -1;
+}
+
+/// @brief writes the current records to a new file, then replaces the manifest with it
+static int manifest_rewrite(manifest_t *man) {
+    int rval = -1;
+    FILE *fp = NULL;
+    char *tmp = NULL;
+
+    size_t len = strlen(man->fn) + 5;
+    if(NULL == (tmp = malloc(len))) goto cleanup;
+    snprintf(tmp, len, "%s.tmp", man->fn);
+    if(NULL == (fp = fopen(tmp, "w"))) goto cleanup;
+    int err = 0;
+    for(int i = 0; (0 == err) && (i < man->num_inputs); i++) {
+        manifest_input_t *in = &man->inputs[i];
+        err = manifest_write(fp, 'I', &in->input);
+        for(int j = 0; (0 == err) && (j < in->num_outputs); j++) {
+            err = manifest_write(fp, 'O', &in->outputs[j]);
+        }
+    }
+    if((0 != fclose(fp)) || (err)) {
+        fp = NULL;
+        remove(tmp);
+        goto cleanup;
+    }
+    fp = NULL;
+    if(0 != rename(tmp, man->fn)) {
+        remove(man->fn); // rename will not replace an existing file on some systems
+        if(0 != rename(tmp, man->fn)) goto cleanup;
+    }
+    rval = 0;
+
+cleanup:
+    fclose_s(fp);
+    free_s(tmp);
+    return rval;
+}
+
+int manifest_open(manifest_t *man, const char *fn) {
+    bool partial = false;
+
+    if(manifest_load(man, fn, &partial) < 0) {
+        return -1;
+    }
+    // appending to a line cut short would spoil the next record, so it is removed first
+    if((partial) && (0 != manifest_rewrite(man))) {
+        manifest_free(man);
+        return -1;
+    }
+    if(NULL == (man->fp = fopen(fn, "a"))) {
+        manifest_free(man);
+        return -1;
+    }
+    return 0;
+}
+
+int manifest_read(manifest_t *man, const char *fn) {
+    bool partial = false;
+    int rval = manifest_load(man, fn, &partial);
+    if(rval > 0) { // does not exist
+        manifest_free(man);
+        return -1;
+    }
+    return rval;
+}
+
+int manifest_close(manifest_t *man) {
+    int rval = 0;
+
+    // rewrite the manifest with only the current records, if any were replaced
+    if(man->fp) {
+        fclose_s(man->fp);
+        if(man->changed) {
+            rval = manifest_rewrite(man);
+        }
+    }
+    manifest_free(man);
+    return rval;
+}
+
+int manifest_stat(manifest_entry_t *e) {
+    struct stat st;
+    if(0 != stat(e->name, &st)) {
+        return -1;
+    }
+    e->size = st.st_size;
+    e->mtime = (int64_t)st.st_mtime * 1000000000;
+    // sub second times, where available, so a file changed twice in a second is caught
+#if defined(__APPLE__)
+    e->mtime += st.st_mtimespec.tv_nsec;
+#elif !defined(_WIN32)
+    e->mtime += st.st_mtim.tv_nsec;
+#endif
+    return 0;
+}
+
+int manifest_hash(const char *name, uint32_t *crc) {
+    FILE *fp = NULL;
+    uint8_t *buf = NULL;
+    size_t nr;
+
+    *crc = 0;
+    if((NULL == (fp = fopen(name, "rb"))) || (NULL == (buf = malloc(CRCBUFSZ)))) {
+        fclose_s(fp);
+        return -1;
+    }
+    while(0 < (nr = fread(buf, 1, CRCBUFSZ, fp))) {
+        *crc = crc32c(*crc, buf, nr);
+    }
+    int rval = ferror(fp) ? -1 : 0;
+    fclose(fp);
+    free(buf);
+    return rval;
+}
+
+const manifest_input_t *manifest_input(const manifest_t *man, const char *name) {
+    int idx = manifest_lookup(man, name);
+    return (idx < 0) ? NULL : &man->inputs[idx];
+}
+
+const manifest_entry_t *manifest_output(const manifest_input_t *in, const char *name) {
+    int idx = index_find(&in->index, in->outputs, output_name, name);
+    return (idx < 0) ? NULL : &in->outputs[idx];
+}
+
+int manifest_set_input(manifest_t *man, const manifest_entry_t *input, bool keep) {
+    int prev = manifest_lookup(man, input->name);
+
+    // an unchanged input that is already last in the file needs nothing written, the
+    // outputs added for it follow its 'I' line
+    if((keep) && (prev >= 0) && (prev == man->last) && (manifest_same(&man->inputs[prev].input, input))) {
+        man->cur = prev;
+        return 0;
+    }
+    if((man->cur = manifest_put_input(man, input)) < 0) {
+        return -1;
+    }
+    manifest_input_t *in = &man->inputs[man->cur];
+    if(!keep) {
+        manifest_clear(in);
+    }
+    // an input record drops its outputs before it, so the kept ones are written again
+    if(prev >= 0) {
+        man->changed = true;
+    }
+    man->last = man->cur;
+    int err = manifest_write(man->fp, 'I', input);
+    for(int i = 0; (0 == err) && (i < in->num_outputs); i++) {
+        err = manifest_write(man->fp, 'O', &in->outputs[i]);
+    }
+    return ((err) || (0 != fflush(man->fp))) ? -1 : 0;
+}
+
+int manifest_add(manifest_t *man, const manifest_entry_t *output) {
+    if(man->cur < 0) {
+        return -1;
+    }
+    const manifest_entry_t *rec = manifest_find(man, output->name);
+    if((rec) && (manifest_same(rec, output))) {
+        return 0; // already recorded
+    }
+    int put = manifest_put(&man->inputs[man->cur], output);
+    if(put < 0) {
+        return -1;
+    }
+    if(put > 0) {
+        man->changed = true;
+    }
+    // flushed straight away, so an interrupted run keeps everything it finished
+    if((0 != manifest_write(man->fp, 'O', output)) || (0 != fflush(man->fp))) {
+        return -1;
+    }
+    return 0;
+}
+
+const manifest_entry_t *manifest_find(const manifest_t *man, const char *name) {
+    if(man->cur < 0) {
+        return NULL;
+    }
+    return manifest_output(&man->inputs[man->cur], name);
+}
+
+bool manifest_current(const manifest_t *man, const char *name, bool verify) {
+    const manifest_entry_t *rec = manifest_find(man, name);
+    manifest_entry_t e = {(char *)name, 0, 0, 0};
+    if((NULL == rec) || (0 != manifest_stat(&e))) {
+        return false;
+    }
+    if((e.size != rec->size) || (e.mtime != rec->mtime)) {
+        return false;
+    }
+    if(!verify) {
+        return true;
+    }
+    // the size and time can be kept by a copy or an edit, which only the contents show
+    return ((0 == manifest_hash(name, &e.crc)) && (e.crc == rec->crc));
+}
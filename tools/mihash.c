@@ -0,0 +1,162 @@
+#include <stdlib.h>
+#include <string.h>
+#include "mihash.h"
+#include "util.h"
+
+// a substring and the entry it is from, for sorting a table
+typedef struct {
+    uint64_t    key;
+    uint32_t    idx;
+} mih_key_t;
+
+static inline int mih_distance(uint64_t a, uint64_t b) {
+    return __builtin_popcountll(a ^ b);
+}
+
+/// @brief the value of substring 'c' of a hash
+static inline uint64_t mih_chunk(const mihash_t *mih, int c, uint64_t hash) {
+    uint64_t mask = (64 == mih->bits[c]) ? ~0ULL : ((1ULL << mih->bits[c]) - 1);
+    return (hash >> mih->shift[c]) & mask;
+}
+
+static int mih_compare(const void *a, const void *b) {
+    const mih_key_t *ka = a;
+    const mih_key_t *kb = b;
+    if(ka->key != kb->key) {
+        return (ka->key > kb->key) ? 1 : -1;
+    }
+    return (ka->idx > kb->idx) ? 1 : ((ka->idx < kb->idx) ? -1 : 0);
+}
+
+void mihash_init(mihash_t *mih, int radius) {
+    memset(mih, 0, sizeof(mihash_t));
+    mih->radius = radius;
+    if((radius < 0) || (radius + 1 > MIH_MAXCHUNKS)) {
+        return; // every hash is compared
+    }
+
+    // split the 64 bits as evenly as they go into radius+1 substrings
+    mih->num_chunks = radius + 1;
+    int shift = 0;
+    for(int c = 0; c < mih->num_chunks; c++) {
+        mih->shift[c] = shift;
+        mih->bits[c] = 64 / mih->num_chunks + ((c < (64 % mih->num_chunks)) ? 1 : 0);
+        shift += mih->bits[c];
+    }
+}
+
+void mihash_free(mihash_t *mih) {
+    for(int c = 0; c < MIH_MAXCHUNKS; c++) {
+        free_s(mih->tables[c]);
+    }
+    free_s(mih->entries);
+    free_s(mih->seen);
+    mih->count = 0;
+    mih->size = 0;
+}
+
+int mihash_add(mihash_t *mih, uint64_t hash, size_t id) {
+    if(mih->count == UINT32_MAX) {
+        return -1; // the tables hold 32 bit entry indexes
+    }
+    if(mih->count == mih->size) {
+        size_t n = (mih->size) ? mih->size * 2 : 1024;
+        mih_entry_t *entries = realloc(mih->entries, n * sizeof(mih_entry_t));
+        if(NULL == entries) {
+            return -1;
+        }
+        mih->entries = entries;
+        mih->size = n;
+    }
+    mih->entries[mih->count].hash = hash;
+    mih->entries[mih->count].id = id;
+    mih->count++;
+    return 0;
+}
+
+int mihash_build(mihash_t *mih) {
+    mih_key_t *keys = NULL;
+
+    free_s(mih->seen);
+    if(NULL == (mih->seen = calloc(mih->count + 1, sizeof(uint32_t)))) {
+        return -1;
+    }
+    mih->stamp = 0;
+    if(0 == mih->num_chunks) {
+        return 0;
+    }
+    if(NULL == (keys = malloc((mih->count + 1) * sizeof(mih_key_t)))) {
+        return -1;
+    }
+    for(int c = 0; c < mih->num_chunks; c++) {
+        free_s(mih->tables[c]);
+        if(NULL == (mih->tables[c] = malloc((mih->count + 1) * sizeof(uint32_t)))) {
+            free(keys);
+            return -1;
+        }
+        for(size_t i = 0; i < mih->count; i++) {
+            keys[i].key = mih_chunk(mih, c, mih->entries[i].hash);
+            keys[i].idx = (uint32_t)i;
+        }
+        qsort(keys, mih->count, sizeof(mih_key_t), mih_compare);
+        for(size_t i = 0; i < mih->count; i++) {
+            mih->tables[c][i] = keys[i].idx;
+        }
+    }
+    free(keys);
+    return 0;
+}
+
+/// @brief compares an entry with the query, if no other substring has found it already
+static size_t mih_check(mihash_t *mih, uint32_t idx, uint64_t hash, mihash_fn_t fn, void *ctx) {
+    if(mih->seen[idx] == mih->stamp) {
+        return 0;
+    }
+    mih->seen[idx] = mih->stamp;
+    int d = mih_distance(hash, mih->entries[idx].hash);
+    if(d > mih->radius) {
+        return 0;
+    }
+    if(fn) fn(ctx, mih->entries[idx].id, d);
+    return 1;
+}
+
+size_t mihash_query(mihash_t *mih, uint64_t hash, mihash_fn_t fn, void *ctx) {
+    size_t found = 0;
+    if((0 == mih->count) || (NULL == mih->seen)) {
+        return 0;
+    }
+
+    // a new stamp for this query, starting over if it wraps
+    if(0 == ++mih->stamp) {
+        memset(mih->seen, 0, mih->count * sizeof(uint32_t));
+        mih->stamp = 1;
+    }
+
+    if(0 == mih->num_chunks) {
+        for(size_t i = 0; i < mih->count; i++) {
+            found += mih_check(mih, (uint32_t)i, hash, fn, ctx);
+        }
+        return found;
+    }
+
+    for(int c = 0; c < mih->num_chunks; c++) {
+        const uint32_t *table = mih->tables[c];
+        uint64_t key = mih_chunk(mih, c, hash);
+
+        // the first entry with this substring
+        size_t lo = 0, hi = mih->count;
+        while(lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if(mih_chunk(mih, c, mih->entries[table[mid]].hash) < key) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        for(size_t i = lo; (i < mih->count) && (key == mih_chunk(mih, c, mih->entries[table[i]].hash)); i++) {
+            found += mih_check(mih, table[i], hash, fn, ctx);
+        }
+    }
+    return found;
+}
@@ -0,0 +1,77 @@
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "parallel.h"
+#include "util.h"
+
+typedef struct {
+    atomic_size_t   next;     // next work item to hand out
+    size_t          count;    // number of work items
+    parallel_fn_t   fn;
+    void            *ctx;
+} pool_t;
+
+typedef struct {
+    pool_t  *pool;
+    int     thread;
+} worker_t;
+
+int parallel_threads(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n < 1) ? 1 : (int)n;
+}
+
+static void *parallel_worker(void *arg) {
+    worker_t *w = arg;
+    pool_t *pool = w->pool;
+    size_t i;
+    while((i = atomic_fetch_add(&pool->next, 1)) < pool->count) {
+        pool->fn(pool->ctx, i, w->thread);
+    }
+    return NULL;
+}
+
+int parallel_for(size_t count, int threads, parallel_fn_t fn, void *ctx) {
+    int rval = -1;
+    pool_t pool;
+    pthread_t *tid = NULL;
+    worker_t *workers = NULL;
+    int started = 0;
+
+    if(threads < 1) threads = parallel_threads();
+    if((size_t)threads > count) threads = (count) ? count : 1;
+
+    atomic_init(&pool.next, 0);
+    pool.count = count;
+    pool.fn = fn;
+    pool.ctx = ctx;
+
+    if((NULL == (tid = calloc(threads, sizeof(pthread_t)))) ||
+       (NULL == (workers = calloc(threads, sizeof(worker_t))))) {
+        goto cleanup;
+    }
+
+    // the calling thread acts as worker 0
+    for(int i = 1; i < threads; i++) {
+        workers[i].pool = &pool;
+        workers[i].thread = i;
+        if(0 != pthread_create(&tid[i], NULL, parallel_worker, &workers[i])) {
+            break;
+        }
+        started++;
+    }
+    workers[0].pool = &pool;
+    workers[0].thread = 0;
+    parallel_worker(&workers[0]);
+
+    for(int i = 1; i <= started; i++) {
+        pthread_join(tid[i], NULL);
+    }
+    rval = 0;
+
+cleanup:
+    free_s(tid);
+    free_s(workers);
+    return rval;
+}
@@ -0,0 +1,164 @@
+#include <string.h>
+#include "scale.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <tmmintrin.h>
+#define SCALE_X86
+#endif
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+int scale_parse(const char *name) {
+    if(0 == strcmp(name, "2x")) return SCALE_2X;
+    if(0 == strcmp(name, "3x")) return SCALE_3X;
+    if(0 == strcmp(name, "4x")) return SCALE_4X;
+    if(0 == strcmp(name, "240")) return SCALE_ASPECT_240;
+    if(0 == strcmp(name, "480")) return SCALE_ASPECT_480;
+    return -1;
+}
+
+/// @brief horizontal scale factor for the given mode
+static int scale_hfactor(scale_mode_t mode) {
+    switch(mode) {
+        case SCALE_2X:          return 2;
+        case SCALE_3X:          return 3;
+        case SCALE_4X:          return 4;
+        case SCALE_ASPECT_480:  return 2;
+        default:                return 1;
+    }
+}
+
+void scale_dims(scale_mode_t mode, uint16_t width, uint16_t height, uint16_t *dst_width, uint16_t *dst_height) {
+    *dst_width = width * scale_hfactor(mode);
+    switch(mode) {
+        case SCALE_ASPECT_240:  *dst_height = (height * 6) / 5; break; // 200 -> 240
+        case SCALE_ASPECT_480:  *dst_height = (height * 12) / 5; break; // 200 -> 480
+        default:                *dst_height = height * scale_hfactor(mode); break;
+    }
+}
+
+// horizontal line kernels, each replicates every source pixel 'n' times
+
+static void line_x2(uint8_t *dst, const uint8_t *src, int width) {
+    int x = 0;
+#if defined(__SSE2__)
+    for(; (x + 16) <= width; x += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)&src[x]);
+        _mm_storeu_si128((__m128i *)&dst[x * 2], _mm_unpacklo_epi8(v, v));
+        _mm_storeu_si128((__m128i *)&dst[x * 2 + 16], _mm_unpackhi_epi8(v, v));
+    }
+#elif defined(__ARM_NEON)
+    for(; (x + 16) <= width; x += 16) {
+        uint8x16_t v = vld1q_u8(&src[x]);
+        uint8x16x2_t o = {{v, v}};
+        vst2q_u8(&dst[x * 2], o);
+    }
+#endif
+    for(; x < width; x++) {
+        dst[x * 2] = dst[x * 2 + 1] = src[x];
+    }
+}
+
+#if defined(SCALE_X86)
+/// @brief SSSE3 part of line_x3(), built for that target so it can be selected at run
+/// time, as the default x86 targets stop at SSE2, which has no byte shuffle
+/// @return number of source pixels done
+__attribute__((target("ssse3")))
+static int line_x3_ssse3(uint8_t *dst, const uint8_t *src, int width) {
+    int x = 0;
+    const __m128i m0 = _mm_setr_epi8(0,0,0,1,1,1,2,2,2,3,3,3,4,4,4,5);
+    const __m128i m1 = _mm_setr_epi8(5,5,6,6,6,7,7,7,8,8,8,9,9,9,10,10);
+    const __m128i m2 = _mm_setr_epi8(10,11,11,11,12,12,12,13,13,13,14,14,14,15,15,15);
+    for(; (x + 16) <= width; x += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)&src[x]);
+        _mm_storeu_si128((__m128i *)&dst[x * 3], _mm_shuffle_epi8(v, m0));
+        _mm_storeu_si128((__m128i *)&dst[x * 3 + 16], _mm_shuffle_epi8(v, m1));
+        _mm_storeu_si128((__m128i *)&dst[x * 3 + 32], _mm_shuffle_epi8(v, m2));
+    }
+    return x;
+}
+#endif
+
+static void line_x3(uint8_t *dst, const uint8_t *src, int width) {
+    int x = 0;
+#if defined(SCALE_X86)
+    if(__builtin_cpu_supports("ssse3")) {
+        x = line_x3_ssse3(dst, src, width);
+    }
+#elif defined(__ARM_NEON)
+    for(; (x + 16) <= width; x += 16) {
+        uint8x16_t v = vld1q_u8(&src[x]);
+        uint8x16x3_t o = {{v, v, v}};
+        vst3q_u8(&dst[x * 3], o);
+    }
+#endif
+    for(; x < width; x++) {
+        dst[x * 3] = dst[x * 3 + 1] = dst[x * 3 + 2] = src[x];
+    }
+}
+
+static void line_x4(uint8_t *dst, const uint8_t *src, int width) {
+    int x = 0;
+#if defined(__SSE2__)
+    for(; (x + 16) <= width; x += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)&src[x]);
+        __m128i lo = _mm_unpacklo_epi8(v, v);
+        __m128i hi = _mm_unpackhi_epi8(v, v);
+        _mm_storeu_si128((__m128i *)&dst[x * 4], _mm_unpacklo_epi16(lo, lo));
+        _mm_storeu_si128((__m128i *)&dst[x * 4 + 16], _mm_unpackhi_epi16(lo, lo));
+        _mm_storeu_si128((__m128i *)&dst[x * 4 + 32], _mm_unpacklo_epi16(hi, hi));
+        _mm_storeu_si128((__m128i *)&dst[x * 4 + 48], _mm_unpackhi_epi16(hi, hi));
+    }
+#elif defined(__ARM_NEON)
+    for(; (x + 16) <= width; x += 16) {
+        uint8x16_t v = vld1q_u8(&src[x]);
+        uint8x16x4_t o = {{v, v, v, v}};
+        vst4q_u8(&dst[x * 4], o);
+    }
+#endif
+    for(; x < width; x++) {
+        dst[x * 4] = dst[x * 4 + 1] = dst[x * 4 + 2] = dst[x * 4 + 3] = src[x];
+    }
+}
+
+int scale_image(memstream_buf_t *dst, memstream_buf_t *src, uint16_t width, uint16_t height, scale_mode_t mode) {
+    uint16_t dw, dh;
+
+    if((NULL == dst) || (NULL == dst->data) || (NULL == src) || (NULL == src->data)) {
+        return -1;
+    }
+    if(src->len < ((size_t)width * height)) {
+        return -1;
+    }
+    scale_dims(mode, width, height, &dw, &dh);
+    if(dst->len < ((size_t)dw * dh)) {
+        return -1;
+    }
+
+    int hf = scale_hfactor(mode);
+    int last_sy = -1;
+    uint8_t *out = dst->data;
+    for(int dy = 0; dy < dh; dy++) {
+        // nearest source line for this destination line
+        int sy = (dy * height) / dh;
+        if(sy == last_sy) { // repeated line, just copy the previous output line
+            memcpy(out, out - dw, dw);
+        } else {
+            const uint8_t *in = &src->data[(size_t)sy * width];
+            switch(hf) {
+                case 2:  line_x2(out, in, width); break;
+                case 3:  line_x3(out, in, width); break;
+                case 4:  line_x4(out, in, width); break;
+                default: memcpy(out, in, width); break;
+            }
+            last_sy = sy;
+        }
+        out += dw;
+    }
+    dst->pos = (size_t)dw * dh;
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include <string.h>
+#include "tar.h"
+
+// offsets of the ustar header fields
+#define TAR_NAME     (0)
+#define TAR_MODE     (100)
+#define TAR_UID      (108)
+#define TAR_GID      (116)
+#define TAR_SIZE     (124)
+#define TAR_MTIME    (136)
+#define TAR_CHKSUM   (148)
+#define TAR_TYPE     (156)
+#define TAR_MAGIC    (257)
+#define TAR_VERSION  (263)
+
+static const uint8_t zeros[TAR_BLOCKSZ];
+
+/// @brief writes a zero padded octal number into a header field of 'len' bytes (including terminator)
+static void tar_octal(uint8_t *field, int len, uint64_t val) {
+    field[len - 1] = 0;
+    for(int i = len - 2; i >= 0; i--) {
+        field[i] = '0' + (val & 7);
+        val >>= 3;
+    }
+}
+
+void tar_header_init(tar_header_t *tmpl, time_t mtime) {
+    uint8_t *b = tmpl->block;
+    memset(b, 0, TAR_BLOCKSZ);
+    tar_octal(&b[TAR_MODE], 8, 0644);
+    tar_octal(&b[TAR_UID], 8, 0);
+    tar_octal(&b[TAR_GID], 8, 0);
+    tar_octal(&b[TAR_MTIME], 12, (uint64_t)mtime);
+    b[TAR_TYPE] = '0'; // regular file
+    memcpy(&b[TAR_MAGIC], "ustar", 6);
+    memcpy(&b[TAR_VERSION], "00", 2);
+}
+
+int tar_write_entry(FILE *fp, const tar_header_t *tmpl, const char *name, const void *data, size_t size) {
+    tar_header_t hdr = *tmpl;
+    uint8_t *b = hdr.block;
+
+    size_t namelen = strlen(name);
+    if(namelen >= TAR_NAMESZ) {
+        return -1;
+    }
+    memcpy(&b[TAR_NAME], name, namelen);
+    tar_octal(&b[TAR_SIZE], 12, size);
+
+    // the checksum is calculated with the checksum field itself set to spaces
+    memset(&b[TAR_CHKSUM], ' ', 8);
+    uint32_t sum = 0;
+    for(int i = 0; i < TAR_BLOCKSZ; i++) {
+        sum += b[i];
+    }
+    tar_octal(&b[TAR_CHKSUM], 7, sum);
+
+    if(1 != fwrite(b, TAR_BLOCKSZ, 1, fp)) {
+        return -2;
+    }
+    if((size) && (1 != fwrite(data, size, 1, fp))) {
+        return -2;
+    }
+    size_t pad = (TAR_BLOCKSZ - (size % TAR_BLOCKSZ)) % TAR_BLOCKSZ;
+    if((pad) && (1 != fwrite(zeros, pad, 1, fp))) {
+        return -2;
+    }
+    return 0;
+}
+
+int tar_write_end(FILE *fp) {
+    if((1 != fwrite(zeros, TAR_BLOCKSZ, 1, fp)) || (1 != fwrite(zeros, TAR_BLOCKSZ, 1, fp))) {
+        return -2;
+    }
+    return 0;
+}
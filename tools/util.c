@@ -33,3 +33,35 @@ char *filename(char *path) {
 		return path;
 	return &path[i+1];
 }
+
+/// @brief prints a string as a JSON string, escaping as needed
+/// @param fo handle to an open file
+/// @param s the string, it ends at 'len' characters or a null, whichever is first
+/// @param len maximum length of the string
+void json_str(FILE *fo, const char *s, int len) {
+    fputc('"', fo);
+    for(int i = 0; (i < len) && s[i]; i++) {
+        unsigned char c = s[i];
+        if(('"' == c) || ('\\' == c)) {
+            fprintf(fo, "\\%c", c);
+        } else if(c < 0x20) {
+            fprintf(fo, "\\u%04x", c);
+        } else {
+            fputc(c, fo);
+        }
+    }
+    fputc('"', fo);
+}
+
+/// @brief prints a string as a CSV field, quoting it
+/// @param fo handle to an open file
+/// @param s the string, it ends at 'len' characters or a null, whichever is first
+/// @param len maximum length of the string
+void csv_str(FILE *fo, const char *s, int len) {
+    fputc('"', fo);
+    for(int i = 0; (i < len) && s[i]; i++) {
+        if('"' == s[i]) fputc('"', fo);
+        fputc(s[i], fo);
+    }
+    fputc('"', fo);
+}